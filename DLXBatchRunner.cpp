@@ -0,0 +1,65 @@
+#include "DLXBatchRunner.h"
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+DLXBatchRunner::DLXBatchRunner(shared_ptr<const DLXCompiledProgram> program, unsigned threads)
+	: program(program), threads(threads)
+{
+	if (this->threads == 0)
+		this->threads = max(1u, thread::hardware_concurrency());
+}
+
+vector<DLXBatchRunner::Job> DLXBatchRunner::readJobList(istream& listStream)
+{
+	vector<Job> jobs;
+	string line;
+	while (getline(listStream, line))
+	{
+		istringstream lineStream(line);
+		Job job;
+		if (!(lineStream >> job.inputDatName))
+			continue;
+		if (!(lineStream >> job.outputDatName))
+			throw DLXJITException("No output dat file for " + job.inputDatName);
+		jobs.push_back(std::move(job));
+	}
+	return jobs;
+}
+
+void DLXBatchRunner::runJob(Job& job)
+{
+	try
+	{
+		DLXExecutionContext context = program->createContext();
+		DLXJIT::loadDataFile(job.inputDatName, context.getDataMemory());
+		program->execute(context);
+		DLXJIT::saveDataFile(job.outputDatName, context.getDataMemory());
+	}
+	catch (exception& ex)
+	{
+		job.error = job.inputDatName + ": " + ex.what();
+	}
+}
+
+size_t DLXBatchRunner::run(vector<Job>& jobs)
+{
+	atomic<size_t> nextJob(0);
+	auto worker = [&]() {
+		for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+			runJob(jobs[i]);
+	};
+	vector<thread> workers;
+	unsigned workerCount = (unsigned)min<size_t>(threads, jobs.size());
+	for (unsigned i = 1; i < workerCount; i++)
+		workers.emplace_back(worker);
+	//the calling thread works as well
+	worker();
+	for (auto& t : workers)
+		t.join();
+
+	return count_if(jobs.begin(), jobs.end(), [](const Job& job) { return !job.error.empty(); });
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "DLXJIT.h"
+
+//Runs one compiled program over many .dat files. Worker threads take
+//(input, output) pairs one at a time, every job with an execution
+//context of its own.
+class DLXBatchRunner
+{
+public:
+	struct Job
+	{
+		std::string inputDatName;
+		std::string outputDatName;
+		//empty when the job succeeded
+		std::string error;
+	};
+
+	//0 threads means one per hardware thread
+	DLXBatchRunner(std::shared_ptr<const DLXCompiledProgram> program, unsigned threads = 0);
+
+	//one "input_dat_file output_dat_file" pair per line, blank lines are skipped
+	static std::vector<Job> readJobList(std::istream& listStream);
+
+	//returns the number of failed jobs, their error is set
+	std::size_t run(std::vector<Job>& jobs);
+private:
+	void runJob(Job& job);
+
+	std::shared_ptr<const DLXCompiledProgram> program;
+	unsigned threads;
+};
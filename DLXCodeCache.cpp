@@ -0,0 +1,151 @@
+#include "DLXCodeCache.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char magic[4] = { 'D', 'L', 'X', 'C' };
+
+template<typename T>
+inline void append(string& bytes, const T& value)
+{
+	bytes.append((const char*)&value, sizeof(T));
+}
+
+//code generators change with every build, so entries of other builds are never used
+static void appendBuildIdentity(string& key)
+{
+	struct stat executable;
+	if (stat("/proc/self/exe", &executable) != 0)
+		return;
+	append(key, (uint64_t)executable.st_size);
+	append(key, (int64_t)executable.st_mtime);
+	append(key, (uint64_t)executable.st_ino);
+}
+
+//FNV-1a
+static uint64_t hashKey(const string& key)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (unsigned char c : key)
+	{
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+DLXCodeCache::DLXCodeCache(const string& directory, const vector<DLXInstruction>& instructions, const string& options)
+	: directory(directory)
+{
+	if (directory.empty())
+		return;
+	key = options;
+	key.push_back('\0');
+	appendBuildIdentity(key);
+	//field by field, the union and padding would make the key depend on garbage
+	for (const auto& instr : instructions)
+	{
+		append(key, instr.opcode);
+		append(key, instr.rs1);
+		append(key, instr.rs2);
+		append(key, instr.rd);
+		append(key, instr.imm);
+		append(key, instr.target);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.dlxc", (unsigned long long)hashKey(key));
+	path = directory + "/" + name;
+}
+
+template<typename T>
+static bool readValue(istream& stream, T& value)
+{
+	return (bool)stream.read((char*)&value, sizeof(T));
+}
+
+template<typename T>
+static bool readVector(istream& stream, vector<T>& values)
+{
+	uint64_t count;
+	if (!readValue(stream, count) || count > (1ull << 32))
+		return false;
+	values.resize(count);
+	return count == 0 || (bool)stream.read((char*)values.data(), count * sizeof(T));
+}
+
+template<typename T>
+static void writeVector(ostream& stream, const vector<T>& values)
+{
+	uint64_t count = values.size();
+	stream.write((const char*)&count, sizeof(count));
+	stream.write((const char*)values.data(), count * sizeof(T));
+}
+
+bool DLXCodeCache::load(vector<char>& code, vector<size_t>& offsets, vector<size_t>& sourcePositions, size_t& dataMemoryFootprint)
+{
+	if (directory.empty())
+		return false;
+	ifstream entry(path, ios::in | ios::binary);
+	if (!entry)
+		return false;
+
+	char entryMagic[sizeof(magic)];
+	uint64_t keySize;
+	if (!entry.read(entryMagic, sizeof(entryMagic)) || !equal(magic, magic + sizeof(magic), entryMagic))
+		return false;
+	if (!readValue(entry, keySize) || keySize != key.size())
+		return false;
+	string entryKey(keySize, '\0');
+	if (!entry.read(&entryKey[0], keySize) || entryKey != key)
+		return false;
+
+	vector<char> entryCode;
+	vector<size_t> entryOffsets, entrySourcePositions;
+	uint64_t footprint;
+	if (!readVector(entry, entryCode) || !readVector(entry, entryOffsets) || !readVector(entry, entrySourcePositions) ||
+		!readValue(entry, footprint))
+		return false;
+	code.swap(entryCode);
+	offsets.swap(entryOffsets);
+	sourcePositions.swap(entrySourcePositions);
+	dataMemoryFootprint = (size_t)footprint;
+	return true;
+}
+
+void DLXCodeCache::store(const vector<char>& code, const vector<size_t>& offsets, const vector<size_t>& sourcePositions,
+	size_t dataMemoryFootprint)
+{
+	if (directory.empty())
+		return;
+	mkdir(directory.c_str(), 0755);
+
+	//written aside and renamed, so other processes never see half of an entry
+	string temporaryPath = path + "." + to_string(getpid());
+	{
+		ofstream entry(temporaryPath, ios::out | ios::binary | ios::trunc);
+		if (!entry)
+			return;
+		uint64_t keySize = key.size();
+		entry.write(magic, sizeof(magic));
+		entry.write((const char*)&keySize, sizeof(keySize));
+		entry.write(key.data(), key.size());
+		writeVector(entry, code);
+		writeVector(entry, offsets);
+		writeVector(entry, sourcePositions);
+		uint64_t footprint = dataMemoryFootprint;
+		entry.write((const char*)&footprint, sizeof(footprint));
+		if (!entry.flush())
+		{
+			entry.close();
+			remove(temporaryPath.c_str());
+			return;
+		}
+	}
+	if (rename(temporaryPath.c_str(), path.c_str()) != 0)
+		remove(temporaryPath.c_str());
+}
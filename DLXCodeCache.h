@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DLXInstruction.h"
+
+//On-disk cache of generated native code, one file per program in a cache
+//directory. Entries are addressed by a hash of the decoded program, the
+//backend options and the running executable, and hold everything a backend
+//needs to map the program without compiling it: position independent code,
+//code offsets of the optimized instructions, their source positions and the
+//data memory footprint of the program.
+//The cache is optional, entries that can not be read or written are ignored.
+class DLXCodeCache
+{
+public:
+	//empty directory disables the cache
+	DLXCodeCache(const std::string& directory, const std::vector<DLXInstruction>& instructions, const std::string& options);
+
+	//false on a miss
+	bool load(std::vector<char>& code, std::vector<std::size_t>& offsets, std::vector<std::size_t>& sourcePositions,
+		std::size_t& dataMemoryFootprint);
+	void store(const std::vector<char>& code, const std::vector<std::size_t>& offsets, const std::vector<std::size_t>& sourcePositions,
+		std::size_t dataMemoryFootprint);
+private:
+	std::string directory;
+	//everything the entry depends on, kept in the entry to rule out hash collisions
+	std::string key;
+	std::string path;
+};
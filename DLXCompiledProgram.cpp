@@ -0,0 +1,214 @@
+#include "DLXCompiledProgram.h"
+#include <algorithm>
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+#include <pthread.h>
+#include <ucontext.h>
+#include "DLXExecutableMemory.h"
+#include "DLXJITException.h"
+
+DLXCompiledProgram::DLXCompiledProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters)
+	: byteOrder(byteOrder), dataMemorySize(dataMemorySize), numberOfCounters(numberOfCounters)
+{
+}
+
+DLXCompiledProgram::~DLXCompiledProgram()
+{
+}
+
+void DLXCompiledProgram::prepareContext(DLXExecutionContext& context) const
+{
+	DLXDataMemory& memory = context.getDataMemory();
+	//byte swaps are compiled in
+	if (memory.getByteOrder() != byteOrder)
+		throw DLXJITException("Data memory byte order differs from the compiled program");
+	//stores past the loaded data are kept instead of faulting
+	memory.grow(dataMemorySize);
+	std::vector<uint64_t>& counts = context.getExecutionCounts();
+	if (counts.size() < numberOfCounters)
+		counts.resize(numberOfCounters, 0);
+}
+
+//execute of a native program running on this thread
+struct ActiveExecution
+{
+	uintptr_t codeStart;
+	uintptr_t codeEnd;
+	sigjmp_buf jump;
+	uintptr_t faultAddress;
+	uintptr_t faultPc;
+	//error of a lazily generated block, see DLXLazyNativeProgram::resolve
+	std::exception_ptr failure;
+};
+
+static thread_local ActiveExecution* activeExecution = nullptr;
+static struct sigaction previousSegvAction;
+static struct sigaction previousBusAction;
+
+static uintptr_t getFaultPc(void* userContext)
+{
+	ucontext_t* context = (ucontext_t*)userContext;
+#if defined(__x86_64__)
+	return (uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+#elif defined(__arm__)
+	return (uintptr_t)context->uc_mcontext.arm_pc;
+#else
+	(void)context;
+	return 0;
+#endif
+}
+
+static void handleFault(int number, siginfo_t* info, void* userContext)
+{
+	ActiveExecution* execution = activeExecution;
+	uintptr_t pc = getFaultPc(userContext);
+	if (execution != nullptr && pc >= execution->codeStart && pc < execution->codeEnd)
+	{
+		//instruction fetch from a page that DLXExecutableMemory::write made writable
+		//(only without the double mapping), the instruction runs again until the page is executable
+		if ((uintptr_t)info->si_addr >= pc && (uintptr_t)info->si_addr < pc + 16)
+			return;
+		execution->faultAddress = (uintptr_t)info->si_addr;
+		execution->faultPc = pc;
+		//execute does not save the signal mask, faults of later programs have to be delivered again
+		sigset_t faults;
+		sigemptyset(&faults);
+		sigaddset(&faults, SIGSEGV);
+		sigaddset(&faults, SIGBUS);
+		pthread_sigmask(SIG_UNBLOCK, &faults, nullptr);
+		siglongjmp(execution->jump, 1);
+	}
+	//not caused by generated code, whoever handled it before does
+	const struct sigaction& previous = number == SIGSEGV ? previousSegvAction : previousBusAction;
+	if ((previous.sa_flags & SA_SIGINFO) != 0)
+		previous.sa_sigaction(number, info, userContext);
+	else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN)
+		previous.sa_handler(number);
+	else
+		signal(number, SIG_DFL); //the faulting instruction runs again and terminates the process
+}
+
+static bool installFaultHandlers()
+{
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = handleFault;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGSEGV, &action, &previousSegvAction) != 0 || sigaction(SIGBUS, &action, &previousBusAction) != 0)
+		throw DLXJITException("Unable to install the data memory fault handler");
+	return true;
+}
+
+DLXNativeProgram::DLXNativeProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters,
+	const void* code, std::size_t size, SourceAddresses&& sourceAddresses)
+	: DLXCompiledProgram(byteOrder, dataMemorySize, numberOfCounters), entry((Entry)DLXExecutableMemory::instance().add(code, size)), size(size),
+	sourceAddresses(std::move(sourceAddresses))
+{
+	static const bool faultHandlersInstalled = installFaultHandlers();
+	(void)faultHandlersInstalled;
+}
+
+DLXNativeProgram::DLXNativeProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters, std::size_t capacity)
+	: DLXCompiledProgram(byteOrder, dataMemorySize, numberOfCounters), entry((Entry)DLXExecutableMemory::instance().reserve(capacity)), size(capacity)
+{
+	static const bool faultHandlersInstalled = installFaultHandlers();
+	(void)faultHandlersInstalled;
+}
+
+DLXNativeProgram::~DLXNativeProgram()
+{
+	DLXExecutableMemory::instance().remove((void*)entry, size);
+}
+
+uint32_t DLXNativeProgram::getInstructionAddress(std::size_t codeOffset) const
+{
+	return findInstructionAddress(sourceAddresses, codeOffset);
+}
+
+uint32_t DLXNativeProgram::findInstructionAddress(const SourceAddresses& sourceAddresses, std::size_t codeOffset)
+{
+	auto next = std::upper_bound(sourceAddresses.begin(), sourceAddresses.end(), codeOffset,
+		[](std::size_t offset, const SourceAddress& address) { return offset < address.codeOffset; });
+	return next == sourceAddresses.begin() ? 0 : (next - 1)->instructionAddress;
+}
+
+void DLXNativeProgram::execute(DLXExecutionContext& context) const
+{
+	prepareContext(context);
+	uint8_t* data = context.getDataMemory().data();
+	ActiveExecution execution;
+	execution.codeStart = (uintptr_t)entry;
+	execution.codeEnd = execution.codeStart + size;
+	ActiveExecution* outer = activeExecution;
+	activeExecution = &execution;
+	//saving the signal mask would cost a system call per execution
+	if (sigsetjmp(execution.jump, 0) != 0)
+	{
+		activeExecution = outer;
+		uint32_t instructionAddress = getInstructionAddress(execution.faultPc - execution.codeStart);
+		//the generated code forms data + 32 bit DLX address, anything else is not a DLX data access
+		//(on 32 bit hosts the subtraction wraps like the address did)
+		uint64_t offset = (uint64_t)(execution.faultAddress - (uintptr_t)data);
+		if (offset > UINT32_MAX)
+		{
+			std::stringstream message;
+			message << "Native code faulted outside of data memory at DLX address 0x" << std::hex << instructionAddress
+				<< " (host address 0x" << execution.faultAddress << ")";
+			throw DLXJITException(message.str());
+		}
+		throw DLXMemoryAccessException(instructionAddress, (uint32_t)offset);
+	}
+	entry(data, context.getRegisters(), context.getExecutionCounts().data());
+	activeExecution = outer;
+	if (execution.failure)
+		std::rethrow_exception(execution.failure);
+}
+
+DLXLazyNativeProgram::DLXLazyNativeProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters,
+	std::size_t capacity, std::unique_ptr<Generator>&& generator)
+	: DLXNativeProgram(byteOrder, dataMemorySize, numberOfCounters, capacity), generator(std::move(generator))
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	exitOffset = this->generator->generateEntry(*this);
+}
+
+uint32_t DLXLazyNativeProgram::getInstructionAddress(std::size_t codeOffset) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return findInstructionAddress(blockSourceAddresses, codeOffset);
+}
+
+void DLXLazyNativeProgram::writeCode(std::size_t offset, const void* code, std::size_t size) const
+{
+	if (offset + size > getCodeSize())
+		throw DLXJITException("Lazily generated code does not fit into its executable memory");
+	DLXExecutableMemory::instance().write((uint8_t*)getCode() + offset, code, size);
+}
+
+void DLXLazyNativeProgram::addSourceAddress(std::size_t codeOffset, uint32_t instructionAddress) const
+{
+	blockSourceAddresses.push_back({ codeOffset, instructionAddress });
+}
+
+uintptr_t DLXLazyNativeProgram::resolve(const DLXLazyNativeProgram* program, uint32_t position)
+{
+	std::lock_guard<std::mutex> lock(program->mutex);
+	//the generator is left in between blocks by an error, it is not used again
+	if (!program->failure)
+	{
+		//exceptions can not pass the generated code
+		try
+		{
+			return (uintptr_t)program->getCode() + program->generator->generateBlock(*program, position);
+		}
+		catch (...)
+		{
+			program->failure = std::current_exception();
+		}
+	}
+	activeExecution->failure = program->failure;
+	return (uintptr_t)program->getCode() + program->exitOffset;
+}
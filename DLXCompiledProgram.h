@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "DLXExecutionContext.h"
+
+//Result of compiling a DLX program with one of the engines. It does not
+//change after it is created, so any number of threads may execute it at
+//once, every one with an execution context of its own.
+class DLXCompiledProgram
+{
+public:
+	//dataMemorySize: data memory the program may access (DLXMemoryFootprintAnalysis),
+	//0 when unknown; numberOfCounters: execution counts the program adds to, 0 when not counting
+	DLXCompiledProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters = 0);
+	virtual ~DLXCompiledProgram();
+
+	//throws DLXJITException when the context has another data byte order
+	virtual void execute(DLXExecutionContext& context) const = 0;
+
+	//data byte order the program was compiled for
+	DLXDataByteOrder getByteOrder() const { return byteOrder; }
+	//data memory of a context is grown to this size before the program runs
+	std::size_t getDataMemorySize() const { return dataMemorySize; }
+	//execution counts of a context are extended to this number before the program runs
+	std::size_t getNumberOfCounters() const { return numberOfCounters; }
+	DLXExecutionContext createContext() const { return DLXExecutionContext(byteOrder); }
+protected:
+	//checks the byte order, grows data memory and the execution counts, called first by execute
+	void prepareContext(DLXExecutionContext& context) const;
+
+	const DLXDataByteOrder byteOrder;
+	const std::size_t dataMemorySize;
+	const std::size_t numberOfCounters;
+};
+
+//Program generated by DLXJITX64 or DLXJITArm7 in DLXExecutableMemory.
+//Loads and stores outside of data memory fault in its guard regions (see
+//DLXDataMemory); execute turns the fault into a DLXMemoryAccessException.
+class DLXNativeProgram : public DLXCompiledProgram
+{
+public:
+	typedef void(*Entry)(uint8_t* data_memory, uint32_t* registers, uint64_t* execution_counts);
+
+	//first byte of the code generated for the instruction at a DLX address
+	struct SourceAddress
+	{
+		std::size_t codeOffset;
+		uint32_t instructionAddress;
+	};
+	//ordered by codeOffset
+	typedef std::vector<SourceAddress> SourceAddresses;
+
+	//code is copied into executable memory
+	DLXNativeProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters,
+		const void* code, std::size_t size, SourceAddresses&& sourceAddresses);
+	~DLXNativeProgram() override;
+
+	void execute(DLXExecutionContext& context) const override;
+
+	const void* getCode() const { return (const void*)entry; }
+	std::size_t getCodeSize() const { return size; }
+	//DLX address of the instruction the code at codeOffset was generated for
+	virtual uint32_t getInstructionAddress(std::size_t codeOffset) const;
+protected:
+	//capacity bytes of executable memory, the code is written later
+	DLXNativeProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters, std::size_t capacity);
+	static uint32_t findInstructionAddress(const SourceAddresses& sourceAddresses, std::size_t codeOffset);
+private:
+	DLXNativeProgram(const DLXNativeProgram&) = delete;
+	DLXNativeProgram& operator=(const DLXNativeProgram&) = delete;
+
+	Entry entry;
+	std::size_t size;
+	SourceAddresses sourceAddresses;
+};
+
+//Native program generated one basic block at a time, see
+//DLXJIT::setLazyCompilation. At first only the entry block exists. A branch
+//to any other block jumps to a stub that calls resolve, which has the
+//generator append the block and patch the branches leading to it.
+class DLXLazyNativeProgram : public DLXNativeProgram
+{
+public:
+	class Generator
+	{
+	public:
+		virtual ~Generator() {}
+		//writes the code the program is entered at, returns the code offset
+		//that leaves the program without storing registers
+		virtual std::size_t generateEntry(const DLXLazyNativeProgram& program) = 0;
+		//appends the block starting at the instruction if it does not exist yet,
+		//patches the branches to it and returns its code offset
+		virtual std::size_t generateBlock(const DLXLazyNativeProgram& program, uint32_t position) = 0;
+	};
+
+	//capacity has to hold the code of all blocks
+	DLXLazyNativeProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, std::size_t numberOfCounters, std::size_t capacity,
+		std::unique_ptr<Generator>&& generator);
+
+	uint32_t getInstructionAddress(std::size_t codeOffset) const override;
+
+	//for generators, offsets are relative to the start of the code
+	void writeCode(std::size_t offset, const void* code, std::size_t size) const;
+	//has to be called with increasing code offsets
+	void addSourceAddress(std::size_t codeOffset, uint32_t instructionAddress) const;
+
+	//called by the stubs, returns the address of the block at position; when it can not be
+	//generated the address of the exit, execute throws the error once it is left
+	static uintptr_t resolve(const DLXLazyNativeProgram* program, uint32_t position);
+private:
+	std::unique_ptr<Generator> generator;
+	std::size_t exitOffset;
+	//held while a block is generated and while source addresses are read
+	mutable std::mutex mutex;
+	mutable SourceAddresses blockSourceAddresses;
+	mutable std::exception_ptr failure;
+};
@@ -0,0 +1,325 @@
+#include "DLXDatFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DLXJITException.h"
+#include "DLXOutputFile.h"
+
+using namespace std;
+
+enum DLXDatRepresentationSize
+{
+	BYTE = 0,
+	HALF = 1,
+	WORD = 2
+};
+
+enum DLXDatRepresentationFormatBase
+{
+	UNSIGNED_HEXADECIMAL = 0,
+	UNSIGNED_DECIMAL = 1,
+	SIGNED_DECIMAL = 2
+};
+
+static const char hexDigits[] = "0123456789abcdef";
+
+//reads text in place, one line at a time
+class DatScanner
+{
+public:
+	DatScanner(const char* text, size_t length)
+		: position(text), end(text + length), line(1)
+	{
+	}
+
+	bool atEnd() const { return position == end; }
+	unsigned getLine() const { return line; }
+
+	//blanks other than the line end are skipped, true at the end of the line or text
+	bool atLineEnd()
+	{
+		while (position != end && (*position == ' ' || *position == '\t' || *position == '\r'))
+			position++;
+		return position == end || *position == '\n';
+	}
+
+	void nextLine()
+	{
+		const char* lineEnd = (const char*)memchr(position, '\n', end - position);
+		position = lineEnd == nullptr ? end : lineEnd + 1;
+		line++;
+	}
+
+	//rest of the line without the line end
+	string readLine()
+	{
+		const char* lineEnd = (const char*)memchr(position, '\n', end - position);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		string text(position, lineEnd);
+		if (!text.empty() && text.back() == '\r')
+			text.pop_back();
+		position = lineEnd == end ? end : lineEnd + 1;
+		line++;
+		return text;
+	}
+
+	bool skip(char c)
+	{
+		if (position == end || *position != c)
+			return false;
+		position++;
+		return true;
+	}
+
+	//number after optional blanks, false when there is none
+	bool readNumber(bool hexadecimal, int64_t& value)
+	{
+		if (atLineEnd())
+			return false;
+		bool negative = !hexadecimal && skip('-');
+		uint64_t magnitude = 0;
+		const char* start = position;
+		while (position != end)
+		{
+			unsigned digit;
+			char c = *position;
+			if (c >= '0' && c <= '9')
+				digit = c - '0';
+			else if (hexadecimal && c >= 'a' && c <= 'f')
+				digit = c - 'a' + 10;
+			else if (hexadecimal && c >= 'A' && c <= 'F')
+				digit = c - 'A' + 10;
+			else
+				break;
+			magnitude = magnitude * (hexadecimal ? 16 : 10) + digit;
+			position++;
+		}
+		if (position == start)
+			return false;
+		value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+		return true;
+	}
+private:
+	const char* position;
+	const char* end;
+	unsigned line;
+};
+
+static void invalidContent(const DatScanner& scanner)
+{
+	throw DLXJITException("Invalid dat file - content line " + to_string(scanner.getLine()));
+}
+
+//value of a Size= or Base= line, which is a decimal number up to maximum
+static int64_t readSetting(const string& line, size_t keySize, int64_t maximum, unsigned lineNumber)
+{
+	DatScanner scanner(line.data() + keySize, line.size() - keySize);
+	int64_t value;
+	if (!scanner.readNumber(false, value) || !scanner.atLineEnd() || value < 0 || value > maximum)
+		throw DLXJITException("Invalid dat file - header line " + to_string(lineNumber));
+	return value;
+}
+
+//address of the last content line, so memory can be sized once before parsing
+static size_t findLastAddress(const char* text, size_t length, bool hexadecimal)
+{
+	const char* lineEnd = text + length;
+	while (lineEnd != text)
+	{
+		const char* lineStart = lineEnd;
+		while (lineStart != text && lineStart[-1] != '\n')
+			lineStart--;
+		DatScanner scanner(lineStart, lineEnd - lineStart);
+		int64_t address;
+		if (!scanner.atLineEnd())
+			return scanner.readNumber(hexadecimal, address) && address >= 0 ? (size_t)address : 0;
+		lineEnd = lineStart == text ? text : lineStart - 1;
+	}
+	return 0;
+}
+
+void DLXDatFile::parse(const char* text, size_t length, DLXDataMemory& memory)
+{
+	DatScanner scanner(text, length);
+	if (scanner.readLine() != "[Data Memory]")
+		throw DLXJITException("Invalid dat file");
+
+	DLXDatRepresentationSize size = WORD;
+	DLXDatRepresentationFormatBase base = UNSIGNED_HEXADECIMAL;
+
+	const string sizeKey = "Size=";
+	const string baseKey = "Base=";
+
+	bool contentFound = false;
+	while (!scanner.atEnd())
+	{
+		string line = scanner.readLine();
+		if (line == "[Data Memory Content]")
+		{
+			contentFound = true;
+			break;
+		}
+		//readLine went on to the next line
+		unsigned lineNumber = scanner.getLine() - 1;
+		if (line.compare(0, sizeKey.size(), sizeKey) == 0)
+			size = (DLXDatRepresentationSize)readSetting(line, sizeKey.size(), WORD, lineNumber);
+		else if (line.compare(0, baseKey.size(), baseKey) == 0)
+			base = (DLXDatRepresentationFormatBase)readSetting(line, baseKey.size(), SIGNED_DECIMAL, lineNumber);
+	}
+
+	if (!contentFound)
+		throw DLXJITException("Invalid dat file - no content");
+
+	const bool hexadecimal = base == UNSIGNED_HEXADECIMAL;
+	const size_t width = size == BYTE ? 1 : size == HALF ? 2 : 4;
+	const size_t valuesPerLine = 8;
+	//sized once, storing the values does not extend memory line by line
+	memory.grow(findLastAddress(text, length, hexadecimal) + valuesPerLine * width);
+
+	while (!scanner.atEnd())
+	{
+		if (scanner.atLineEnd())
+		{
+			scanner.nextLine();
+			continue;
+		}
+		int64_t address;
+		if (!scanner.readNumber(hexadecimal, address) || address < 0)
+			invalidContent(scanner);
+		scanner.atLineEnd();
+		if (!scanner.skip(':'))
+			invalidContent(scanner);
+
+		uint32_t words[valuesPerLine];
+		size_t count = 0;
+		int64_t value;
+		while (scanner.readNumber(hexadecimal, value))
+		{
+			if (width == 4)
+			{
+				words[count++] = (uint32_t)value;
+				if (count == valuesPerLine)
+				{
+					memory.saveWords((size_t)address, words, count);
+					address += count * 4;
+					count = 0;
+				}
+			}
+			else
+			{
+				if (width == 1)
+					memory.saveByte((size_t)address, (uint8_t)value);
+				else
+					memory.saveHalf((size_t)address, (uint16_t)value);
+				address += width;
+			}
+		}
+		if (!scanner.atLineEnd())
+			invalidContent(scanner);
+		memory.saveWords((size_t)address, words, count);
+		scanner.nextLine();
+	}
+}
+
+//digits hexadecimal digits of value, most significant first
+inline char* writeHex(char* out, uint64_t value, unsigned digits)
+{
+	for (unsigned i = digits; i-- > 0;)
+	{
+		out[i] = hexDigits[value & 0xF];
+		value >>= 4;
+	}
+	return out + digits;
+}
+
+void DLXDatFile::format(DLXDataMemory& memory, string& text)
+{
+	static const char header[] = "[Data Memory]\nSize=2\nBase=0\n\n[Data Memory Content]\n";
+	const size_t valuesPerLine = 8;
+
+	//partial words at the end are written as whole words
+	size_t size = (memory.size() + 3) & ~(size_t)3;
+	memory.grow(size);
+	size_t words = size / 4;
+
+	unsigned addressDigits = 3;
+	while (size > 0 && ((size - 1) >> (4 * addressDigits)) != 0)
+		addressDigits++;
+	const size_t lineLength = addressDigits + 1 + valuesPerLine * 10 + 1;
+
+	text.resize(sizeof(header) - 1 + (words + valuesPerLine - 1) / valuesPerLine * lineLength);
+	char* out = &text[0];
+	memcpy(out, header, sizeof(header) - 1);
+	out += sizeof(header) - 1;
+
+	uint32_t values[valuesPerLine];
+	for (size_t word = 0; word < words; word += valuesPerLine)
+	{
+		size_t count = min(valuesPerLine, words - word);
+		memory.loadWords(word * 4, values, count);
+		//addresses are at least 3 digits, wider ones only as wide as needed
+		unsigned digits = 3;
+		while (((word * 4) >> (4 * digits)) != 0)
+			digits++;
+		out = writeHex(out, word * 4, digits);
+		*out++ = ':';
+		for (size_t i = 0; i < count; i++)
+		{
+			*out++ = ' ';
+			*out++ = ' ';
+			out = writeHex(out, values[i], 8);
+		}
+		//a partial last line has no line end
+		if (count == valuesPerLine)
+			*out++ = '\n';
+	}
+	text.resize(out - text.data());
+}
+
+void DLXDatFile::load(const string& fileName, DLXDataMemory& memory)
+{
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0)
+		throw DLXJITException("Unable to open " + fileName);
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		throw DLXJITException("Unable to read " + fileName);
+	}
+	size_t length = (size_t)status.st_size;
+	if (length == 0)
+	{
+		close(file);
+		parse("", 0, memory);
+		return;
+	}
+	void* text = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (text == MAP_FAILED)
+		throw DLXJITException("Unable to read " + fileName);
+	try
+	{
+		parse((const char*)text, length, memory);
+	}
+	catch (...)
+	{
+		munmap(text, length);
+		throw;
+	}
+	munmap(text, length);
+}
+
+void DLXDatFile::save(const string& fileName, DLXDataMemory& memory)
+{
+	string text;
+	format(memory, text);
+	//memory may still be mapped from fileName when it holds an image
+	DLXOutputFile file(fileName);
+	file.write(text.data(), text.size());
+	file.commit();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "DLXDataMemory.h"
+
+//Reads and writes data memory in the .dat text format:
+//  [Data Memory]
+//  Size=2          0 bytes, 1 halves, 2 words per value
+//  Base=0          0 hexadecimal, 1 unsigned and 2 signed decimal
+//
+//  [Data Memory Content]
+//  000:  00000001  00000002 ...
+//Every content line starts with the address of its first value. Text is
+//scanned in place and formatted into one buffer, so large images do not go
+//through iostreams value by value.
+class DLXDatFile
+{
+public:
+	//throws DLXJITException when the text is not a valid .dat file
+	static void parse(const char* text, std::size_t length, DLXDataMemory& memory);
+	//words in hexadecimal, 8 per line, the whole memory
+	static void format(DLXDataMemory& memory, std::string& text);
+
+	//the file is mapped and parsed, throws DLXJITException when it can not be read
+	static void load(const std::string& fileName, DLXDataMemory& memory);
+	//the formatted text is written at once, throws DLXJITException when it can not be written
+	static void save(const std::string& fileName, DLXDataMemory& memory);
+};
@@ -0,0 +1,319 @@
+#include "DLXDataMemory.h"
+#include <endian.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "DLXJITException.h"
+
+using namespace std;
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+//generated code forms data + 32 bit register + 32 bit signed offset, all of it is reserved
+static const size_t guardLength = (size_t)1 << 31;
+static const size_t maximumCapacity = (size_t)1 << 32;
+#else
+//the address space is too small for that, only accesses close to data memory are caught
+static const size_t guardLength = (size_t)1 << 20;
+static const size_t maximumCapacity = (size_t)1 << 31;
+#endif
+//data memory starts at a multiple of it, large memory is backed by transparent huge pages
+static const size_t hugePageSize = (size_t)2 << 20;
+//reserved at least on 32 bit hosts, where memory is moved when it grows past the reservation
+static const size_t minimumCapacity = (size_t)16 << 20;
+
+static size_t getPageSize()
+{
+	static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	return pageSize;
+}
+
+static size_t roundUpToPage(size_t size)
+{
+	return (size + getPageSize() - 1) & ~(getPageSize() - 1);
+}
+
+DLXDataMemory::DLXDataMemory()
+	: byteOrder(DATA_BIG_ENDIAN), reservation(nullptr), reservationLength(0), start(nullptr),
+	capacity(0), length(0), accessibleLength(0), shared(false)
+{
+}
+
+DLXDataMemory::DLXDataMemory(const DLXDataMemory& other)
+	: DLXDataMemory()
+{
+	*this = other;
+}
+
+DLXDataMemory::DLXDataMemory(DLXDataMemory&& other)
+	: DLXDataMemory()
+{
+	*this = move(other);
+}
+
+DLXDataMemory& DLXDataMemory::operator=(const DLXDataMemory& other)
+{
+	if (this == &other)
+		return *this;
+	release();
+	byteOrder = other.byteOrder;
+	if (other.length > 0)
+	{
+		grow(other.length);
+		memcpy(start, other.start, other.length);
+	}
+	return *this;
+}
+
+DLXDataMemory& DLXDataMemory::operator=(DLXDataMemory&& other)
+{
+	if (this == &other)
+		return *this;
+	release();
+	byteOrder = other.byteOrder;
+	reservation = other.reservation;
+	reservationLength = other.reservationLength;
+	start = other.start;
+	capacity = other.capacity;
+	length = other.length;
+	accessibleLength = other.accessibleLength;
+	shared = other.shared;
+	other.reservation = other.start = nullptr;
+	other.reservationLength = other.capacity = other.length = other.accessibleLength = 0;
+	other.shared = false;
+	return *this;
+}
+
+DLXDataMemory::~DLXDataMemory()
+{
+	release();
+}
+
+bool DLXDataMemory::isByteSwapNeeded() const
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	return byteOrder == DATA_BIG_ENDIAN;
+#else
+	return false;
+#endif
+}
+
+void DLXDataMemory::setByteOrder(DLXDataByteOrder order)
+{
+	if (order == byteOrder)
+		return;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	detach();
+	grow((length + 3) & ~(size_t)3);
+	for (size_t address = 0; address < length; address += 4)
+	{
+		uint32_t word;
+		memcpy(&word, start + address, sizeof(word));
+		word = __builtin_bswap32(word);
+		memcpy(start + address, &word, sizeof(word));
+	}
+#endif
+	byteOrder = order;
+}
+
+size_t DLXDataMemory::locate(size_t address, size_t width)
+{
+	size_t end = address + width;
+	if (byteOrder == DATA_HOST_ENDIAN)
+	{
+		//the whole word is stored as a host integer
+		end = (end + 3) & ~(size_t)3;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+		address ^= 4 - width;
+#endif
+	}
+	if (end > size())
+		grow(end);
+	return address;
+}
+
+uint8_t DLXDataMemory::loadByte(size_t address)
+{
+	//located before data(), which changes when memory grows
+	size_t offset = locate(address, 1);
+	return data()[offset];
+}
+
+void DLXDataMemory::saveByte(size_t address, uint8_t value)
+{
+	size_t offset = locate(address, 1);
+	data()[offset] = value;
+}
+
+uint16_t DLXDataMemory::loadHalf(size_t address)
+{
+	size_t offset = locate(address, 2);
+	uint16_t value;
+	memcpy(&value, data() + offset, sizeof(value));
+	return byteOrder == DATA_HOST_ENDIAN ? value : be16toh(value);
+}
+
+void DLXDataMemory::saveHalf(size_t address, uint16_t value)
+{
+	if (byteOrder == DATA_BIG_ENDIAN)
+		value = htobe16(value);
+	size_t offset = locate(address, 2);
+	memcpy(data() + offset, &value, sizeof(value));
+}
+
+uint32_t DLXDataMemory::loadWord(size_t address)
+{
+	size_t offset = locate(address, 4);
+	uint32_t value;
+	memcpy(&value, data() + offset, sizeof(value));
+	return byteOrder == DATA_HOST_ENDIAN ? value : be32toh(value);
+}
+
+void DLXDataMemory::saveWord(size_t address, uint32_t value)
+{
+	if (byteOrder == DATA_BIG_ENDIAN)
+		value = htobe32(value);
+	size_t offset = locate(address, 4);
+	memcpy(data() + offset, &value, sizeof(value));
+}
+
+void DLXDataMemory::loadWords(size_t address, uint32_t* values, size_t count)
+{
+	if (count == 0)
+		return;
+	grow(address + count * 4);
+	const uint8_t* source = data() + address;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t value;
+		memcpy(&value, source + i * 4, sizeof(value));
+		values[i] = byteOrder == DATA_HOST_ENDIAN ? value : be32toh(value);
+	}
+}
+
+void DLXDataMemory::saveWords(size_t address, const uint32_t* values, size_t count)
+{
+	if (count == 0)
+		return;
+	grow(address + count * 4);
+	uint8_t* target = data() + address;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t value = byteOrder == DATA_HOST_ENDIAN ? values[i] : htobe32(values[i]);
+		memcpy(target + i * 4, &value, sizeof(value));
+	}
+}
+
+void DLXDataMemory::grow(size_t size)
+{
+	if (byteOrder == DATA_HOST_ENDIAN)
+		size = (size + 3) & ~(size_t)3;
+	if (size <= length)
+		return;
+	if (size > maximumCapacity)
+		throw DLXJITException("Data memory can not grow to " + to_string(size) + " bytes");
+	if (start == nullptr || size > capacity)
+		reserve(max(size * 2, minimumCapacity), 0);
+	detach();
+	//generated code may have stored past the end, inside the last accessible page
+	size_t offset = start - getFirstPage();
+	memset(start + length, 0, min(size, accessibleLength - offset) - length);
+	makeAccessible(size);
+	length = size;
+}
+
+void DLXDataMemory::mapFile(int file, size_t offset, size_t size, DLXDataByteOrder order, bool shared)
+{
+	//mappings start at a page boundary, so start is placed at the same offset in its page
+	size_t startOffset = offset % getPageSize();
+	release();
+	reserve(size, startOffset);
+	size_t mappedLength = roundUpToPage(startOffset + size);
+	if (mmap(getFirstPage(), mappedLength, PROT_READ | PROT_WRITE, MAP_FIXED | (shared ? MAP_SHARED : MAP_PRIVATE), file, offset - startOffset) == MAP_FAILED)
+	{
+		release();
+		throw DLXJITException(string("Unable to map data memory: ") + strerror(errno));
+	}
+	accessibleLength = mappedLength;
+	length = size;
+	byteOrder = order;
+	this->shared = shared;
+}
+
+void DLXDataMemory::reserve(size_t capacity, size_t startOffset)
+{
+	capacity = max(capacity, min(maximumCapacity, minimumCapacity));
+	if (sizeof(void*) > 4)
+		capacity = maximumCapacity;
+	size_t newLength = guardLength + hugePageSize + roundUpToPage(startOffset + capacity) + guardLength;
+	void* newReservation = mmap(nullptr, newLength, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (newReservation == MAP_FAILED)
+		throw DLXJITException(string("Unable to reserve data memory: ") + strerror(errno));
+
+	uint8_t* oldStart = start;
+	size_t oldLength = length;
+	uint8_t* oldReservation = reservation;
+	size_t oldReservationLength = reservationLength;
+	reservation = (uint8_t*)newReservation;
+	reservationLength = newLength;
+	uintptr_t firstPage = ((uintptr_t)reservation + guardLength + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1);
+	start = (uint8_t*)firstPage + startOffset;
+	this->capacity = capacity;
+	accessibleLength = 0;
+	length = 0;
+	shared = false;
+	if (oldLength > 0)
+	{
+		makeAccessible(oldLength);
+		memcpy(start, oldStart, oldLength);
+		length = oldLength;
+	}
+	if (oldReservation != nullptr)
+		munmap(oldReservation, oldReservationLength);
+}
+
+void DLXDataMemory::release()
+{
+	if (reservation != nullptr)
+		munmap(reservation, reservationLength);
+	reservation = start = nullptr;
+	reservationLength = capacity = length = accessibleLength = 0;
+	shared = false;
+}
+
+void DLXDataMemory::makeAccessible(size_t size)
+{
+	uint8_t* firstPage = getFirstPage();
+	size_t newLength = roundUpToPage(start - firstPage + size);
+	if (newLength <= accessibleLength)
+		return;
+	if (mprotect(firstPage + accessibleLength, newLength - accessibleLength, PROT_READ | PROT_WRITE) != 0)
+		throw DLXJITException(string("Unable to extend data memory: ") + strerror(errno));
+#ifdef MADV_HUGEPAGE
+	//only a hint, small memories stay on small pages
+	if (newLength >= hugePageSize)
+		madvise(firstPage, newLength, MADV_HUGEPAGE);
+#endif
+	accessibleLength = newLength;
+}
+
+uint8_t* DLXDataMemory::getFirstPage() const
+{
+	return (uint8_t*)((uintptr_t)start & ~(uintptr_t)(getPageSize() - 1));
+}
+
+void DLXDataMemory::detach()
+{
+	if (!shared)
+		return;
+	uint8_t* firstPage = getFirstPage();
+	vector<uint8_t> contents(firstPage, firstPage + accessibleLength);
+	if (mmap(firstPage, accessibleLength, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
+		throw DLXJITException(string("Unable to copy data memory: ") + strerror(errno));
+	memcpy(firstPage, contents.data(), contents.size());
+	shared = false;
+}
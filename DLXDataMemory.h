@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+enum DLXDataByteOrder
+{
+	DATA_BIG_ENDIAN, //DLX order, little endian hosts swap every word the program loads or stores
+	DATA_HOST_ENDIAN //words in host order, conversion happens only when data is loaded or saved
+};
+
+//Data memory of a DLX program, addressed with DLX byte addresses. It grows
+//when accessed past its end. In DATA_HOST_ENDIAN order accesses have to be
+//naturally aligned, bytes and halves are looked up inside their word.
+//Memory lives in a reserved address range with inaccessible guard regions
+//around it, so out of range accesses of generated code fault instead of
+//hitting other data (see DLXNativeProgram). On 64 bit hosts the guards
+//cover every address data + 32 bit register + 32 bit offset. Contents are
+//anonymous memory or mapped from a file (see DLXMemoryImage).
+class DLXDataMemory
+{
+public:
+	DLXDataMemory();
+	//a copy of mapped memory is anonymous memory
+	DLXDataMemory(const DLXDataMemory& other);
+	DLXDataMemory(DLXDataMemory&& other);
+	DLXDataMemory& operator=(const DLXDataMemory& other);
+	DLXDataMemory& operator=(DLXDataMemory&& other);
+	~DLXDataMemory();
+
+	DLXDataByteOrder getByteOrder() const { return byteOrder; }
+	//current contents are converted to the new order
+	void setByteOrder(DLXDataByteOrder order);
+	//true when words read from memory by generated code have to be byte swapped
+	bool isByteSwapNeeded() const;
+
+	uint8_t loadByte(std::size_t address);
+	void saveByte(std::size_t address, uint8_t value);
+	uint16_t loadHalf(std::size_t address);
+	void saveHalf(std::size_t address, uint16_t value);
+	uint32_t loadWord(std::size_t address);
+	void saveWord(std::size_t address, uint32_t value);
+
+	//count consecutive words, without the per access checks of loadWord and saveWord
+	void loadWords(std::size_t address, uint32_t* values, std::size_t count);
+	void saveWords(std::size_t address, const uint32_t* values, std::size_t count);
+	//memory is extended to at least size bytes, it never shrinks
+	void grow(std::size_t size);
+
+	//size bytes at offset in file become the contents, already in the given
+	//order. They are mapped copy-on-write, or shared so that changes go to
+	//the file. Growing or changing the order ends the sharing, copies are
+	//never shared.
+	void mapFile(int file, std::size_t offset, std::size_t size, DLXDataByteOrder order, bool shared);
+	bool isShared() const { return shared; }
+
+	//the address stays the same while the size does not change
+	uint8_t* data()
+	{
+		if (start == nullptr)
+			reserve(0, 0);
+		return start;
+	}
+	std::size_t size() const { return length; }
+private:
+	//host offset of a naturally aligned access, memory is extended to contain it
+	std::size_t locate(std::size_t address, std::size_t width);
+	//new reservation for at least capacity bytes, start at startOffset in its first
+	//page; current contents are moved into it
+	void reserve(std::size_t capacity, std::size_t startOffset);
+	void release();
+	//pages up to size bytes after start become readable and writable
+	void makeAccessible(std::size_t size);
+	//shared file contents are copied to anonymous memory at the same address
+	void detach();
+	uint8_t* getFirstPage() const;
+
+	DLXDataByteOrder byteOrder;
+	//guard, memory that may become accessible, guard
+	uint8_t* reservation;
+	std::size_t reservationLength;
+	//byte 0 of data memory
+	uint8_t* start;
+	//bytes after start that can become accessible without moving memory
+	std::size_t capacity;
+	std::size_t length;
+	//accessible bytes from the page holding start
+	std::size_t accessibleLength;
+	//accessible pages are a shared file mapping
+	bool shared;
+};
@@ -0,0 +1,210 @@
+#include "DLXExecutableMemory.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "DLXJITException.h"
+
+using namespace std;
+
+static const size_t regionSize = 1 << 20;
+//start of every program, enough for branch targets and SIMD constants on both backends
+static const size_t codeAlignment = 16;
+
+inline size_t roundUp(size_t value, size_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+static void copyCode(uint8_t* destination, const void* code, size_t size)
+{
+	//branches of lazily generated code are patched while other threads may run them
+	if (size == sizeof(uint32_t) && (uintptr_t)destination % sizeof(uint32_t) == 0)
+	{
+		uint32_t value;
+		memcpy(&value, code, sizeof(value));
+		__atomic_store_n((uint32_t*)destination, value, __ATOMIC_RELEASE);
+	}
+	else
+		memcpy(destination, code, size);
+}
+
+DLXExecutableMemory& DLXExecutableMemory::instance()
+{
+	//never destroyed, programs may be released by destructors of static objects
+	static DLXExecutableMemory* memory = new DLXExecutableMemory();
+	return *memory;
+}
+
+DLXExecutableMemory::DLXExecutableMemory()
+	: pageSize(sysconf(_SC_PAGESIZE)), dualMapping(true)
+{
+}
+
+//read/execute and read/write views of one memfd, false when the system does not allow it
+static bool mapTwice(size_t size, void*& base, void*& writableBase)
+{
+	int file = memfd_create("dlxjit", MFD_CLOEXEC);
+	if (file < 0)
+		return false;
+	base = writableBase = MAP_FAILED;
+	if (ftruncate(file, size) == 0)
+	{
+		base = mmap(NULL, size, PROT_READ | PROT_EXEC, MAP_SHARED, file, 0);
+		if (base != MAP_FAILED)
+			writableBase = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	}
+	//the mappings keep the memory
+	close(file);
+	if (writableBase != MAP_FAILED)
+		return true;
+	if (base != MAP_FAILED)
+		munmap(base, size);
+	return false;
+}
+
+DLXExecutableMemory::Region& DLXExecutableMemory::addRegion(size_t minimumSize)
+{
+	size_t size = max(regionSize, roundUp(minimumSize, pageSize));
+	void* base;
+	void* writableBase;
+	//hardened kernels refuse executable memfd mappings (vm.memfd_noexec=2, PaX MPROTECT)
+	if (!dualMapping || !mapTwice(size, base, writableBase))
+	{
+		dualMapping = false;
+		base = mmap(NULL, size, PROT_READ | PROT_EXEC, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (base == MAP_FAILED)
+			throw DLXJITException(string("Unable to allocate executable memory: ") + strerror(errno));
+		writableBase = nullptr;
+	}
+
+	Region region = { (uint8_t*)base, (uint8_t*)writableBase, size, {} };
+	region.freeBlocks[0] = size;
+	regions.push_back(std::move(region));
+	return regions.back();
+}
+
+void DLXExecutableMemory::writeCode(uint8_t* destination, const void* code, size_t size)
+{
+	for (auto& region : regions)
+	{
+		if (destination < region.base || destination + size > region.base + region.size)
+			continue;
+
+		if (region.writableBase == nullptr)
+		{
+			//single mapping, its pages are writable while the code is copied
+			uint8_t* firstPage = (uint8_t*)((uintptr_t)destination / pageSize * pageSize);
+			size_t length = roundUp(destination + size - firstPage, pageSize);
+			if (mprotect(firstPage, length, PROT_READ | PROT_WRITE) != 0)
+				throw DLXJITException(string("Unable to make code memory writable: ") + strerror(errno));
+			copyCode(destination, code, size);
+			if (mprotect(firstPage, length, PROT_READ | PROT_EXEC) != 0)
+				throw DLXJITException(string("Unable to make code memory executable: ") + strerror(errno));
+		}
+		else
+			copyCode(region.writableBase + (destination - region.base), code, size);
+		__builtin___clear_cache((char*)destination, (char*)destination + size);
+		return;
+	}
+	throw DLXJITException("Code is written outside of executable memory");
+}
+
+uint8_t* DLXExecutableMemory::allocate(size_t size)
+{
+	size_t length = roundUp(max(size, (size_t)1), codeAlignment);
+	Region* region = nullptr;
+	map<size_t, size_t>::iterator block;
+	for (auto& candidate : regions)
+	{
+		for (block = candidate.freeBlocks.begin(); block != candidate.freeBlocks.end(); ++block)
+		{
+			if (block->second >= length)
+				break;
+		}
+		if (block != candidate.freeBlocks.end())
+		{
+			region = &candidate;
+			break;
+		}
+	}
+	if (region == nullptr)
+	{
+		region = &addRegion(length);
+		block = region->freeBlocks.begin();
+	}
+
+	size_t offset = block->first;
+	size_t left = block->second - length;
+	region->freeBlocks.erase(block);
+	if (left > 0)
+		region->freeBlocks[offset + length] = left;
+
+	return region->base + offset;
+}
+
+void* DLXExecutableMemory::add(const void* code, size_t size)
+{
+	lock_guard<std::mutex> lock(mutex);
+	uint8_t* destination = allocate(size);
+	writeCode(destination, code, size);
+	return destination;
+}
+
+void* DLXExecutableMemory::reserve(size_t size)
+{
+	lock_guard<std::mutex> lock(mutex);
+	return allocate(size);
+}
+
+void DLXExecutableMemory::write(void* destination, const void* code, size_t size)
+{
+	//pages may be shared with other programs that are written at the same time
+	lock_guard<std::mutex> lock(mutex);
+	writeCode((uint8_t*)destination, code, size);
+}
+
+void DLXExecutableMemory::remove(void* code, size_t size)
+{
+	size_t length = roundUp(max(size, (size_t)1), codeAlignment);
+	lock_guard<std::mutex> lock(mutex);
+
+	for (auto region = regions.begin(); region != regions.end(); ++region)
+	{
+		uint8_t* start = (uint8_t*)code;
+		if (start < region->base || start >= region->base + region->size)
+			continue;
+
+		size_t offset = start - region->base;
+		auto next = region->freeBlocks.lower_bound(offset);
+		if (next != region->freeBlocks.end() && next->first == offset + length)
+		{
+			length += next->second;
+			next = region->freeBlocks.erase(next);
+		}
+		if (next != region->freeBlocks.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				length += previous->second;
+				region->freeBlocks.erase(previous);
+			}
+		}
+		region->freeBlocks[offset] = length;
+
+		//one empty region is kept for the next program
+		if (length == region->size && regions.size() > 1)
+		{
+			munmap(region->base, region->size);
+			if (region->writableBase != nullptr)
+				munmap(region->writableBase, region->size);
+			regions.erase(region);
+		}
+		return;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+//Executable memory shared by all compiled programs. Programs are carved out
+//of large regions, so small ones share pages. Every region is mapped twice:
+//once read/execute, where programs run, and once read/write at another address,
+//where code is copied in. No mapping is writable and executable at once (W^X)
+//and the permissions of pages holding running code never change.
+//Where the system does not allow the second mapping, a region is mapped once and
+//its pages are made writable while code is copied in, then executable again;
+//code running on those pages meanwhile faults and is retried by the fault handler.
+class DLXExecutableMemory
+{
+public:
+	static DLXExecutableMemory& instance();
+
+	//copies code into executable memory and returns its address,
+	//throws DLXJITException when memory can not be mapped or protected
+	void* add(const void* code, std::size_t size);
+	//size bytes of executable memory whose code is copied in later by write
+	void* reserve(std::size_t size);
+	//copies code to destination inside memory returned by add or reserve, threads may
+	//run code next to it meanwhile; 4 aligned bytes are written by a single store
+	void write(void* destination, const void* code, std::size_t size);
+	//gives back memory returned by add or reserve with the same size
+	void remove(void* code, std::size_t size);
+private:
+	DLXExecutableMemory();
+	DLXExecutableMemory(const DLXExecutableMemory&) = delete;
+	DLXExecutableMemory& operator=(const DLXExecutableMemory&) = delete;
+
+	struct Region
+	{
+		//the read/execute view, addresses of programs point into it
+		uint8_t* base;
+		//the read/write view of the same memory, nullptr when permissions are switched instead
+		uint8_t* writableBase;
+		std::size_t size;
+		//offset -> length of unused space, neighbouring blocks are merged
+		std::map<std::size_t, std::size_t> freeBlocks;
+	};
+
+	Region& addRegion(std::size_t minimumSize);
+	//first fit, the mutex has to be held
+	uint8_t* allocate(std::size_t size);
+	//copies through the read/write view of the region holding destination, the mutex has to be held
+	void writeCode(uint8_t* destination, const void* code, std::size_t size);
+
+	std::vector<Region> regions;
+	std::size_t pageSize;
+	//false once mapping a region twice failed
+	bool dualMapping;
+	std::mutex mutex;
+};
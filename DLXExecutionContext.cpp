@@ -0,0 +1,26 @@
+#include "DLXExecutionContext.h"
+#include <string>
+#include "DLXJITException.h"
+
+using namespace std;
+
+DLXExecutionContext::DLXExecutionContext(DLXDataByteOrder order)
+	: registers(numberOfRegisters, 0)
+{
+	dataMemory.setByteOrder(order);
+}
+
+uint32_t DLXExecutionContext::getRegister(int no) const
+{
+	if (no < 0 || no >= numberOfRegisters)
+		throw DLXJITException("Invalid register number: R" + to_string(no));
+	return registers[no];
+}
+
+void DLXExecutionContext::setRegister(int no, uint32_t value)
+{
+	if (no < 0 || no >= numberOfRegisters)
+		throw DLXJITException("Invalid register number: R" + to_string(no));
+	if (no != 0)
+		registers[no] = value;
+}
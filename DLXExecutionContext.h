@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "DLXDataMemory.h"
+
+//State of one execution of a DLX program: data memory and registers.
+//Registers hold the initial values before DLXCompiledProgram::execute
+//(all 0 unless set) and the final ones afterwards when the program was
+//compiled with its final registers kept. Contexts are cheap, one per
+//concurrent execution.
+class DLXExecutionContext
+{
+public:
+	static const int numberOfRegisters = 32;
+
+	explicit DLXExecutionContext(DLXDataByteOrder order = DATA_BIG_ENDIAN);
+
+	DLXDataMemory& getDataMemory() { return dataMemory; }
+	const DLXDataMemory& getDataMemory() const { return dataMemory; }
+
+	uint32_t getRegister(int no) const;
+	//writes to R0 are ignored
+	void setRegister(int no, uint32_t value);
+	//numberOfRegisters words, R0 first
+	uint32_t* getRegisters() { return registers.data(); }
+	//executions of every loaded instruction, filled by programs compiled with
+	//execution counting (DLXJIT::setExecutionCounting); they add up over executions
+	std::vector<uint64_t>& getExecutionCounts() { return executionCounts; }
+	const std::vector<uint64_t>& getExecutionCounts() const { return executionCounts; }
+private:
+	DLXDataMemory dataMemory;
+	std::vector<uint32_t> registers;
+	std::vector<uint64_t> executionCounts;
+};
@@ -0,0 +1,57 @@
+#include "DLXIfConverter.h"
+
+using namespace std;
+
+//none of them touches memory or flags on x64 when compiled into LEA/MOV
+static bool canBePredicated(const DLXInstruction& instr)
+{
+	switch (instr.opcode)
+	{
+	case OP_NOP:
+	case OP_ADD:
+	case OP_ADDI:
+	case OP_SUBI:
+	case OP_LI:
+	case OP_MOV:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void DLXIfConverter::convert(vector<DLXInstruction>& instructions)
+{
+	size_t count = instructions.size();
+	vector<bool> branchTarget(count + 1, false);
+	for (const auto& instr : instructions)
+	{
+		if (isBranch(instr) && instr.target <= count)
+			branchTarget[instr.target] = true;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		DLXInstruction& branch = instructions[i];
+		if (!isBranch(branch))
+			continue;
+		branch.predicated = 0;
+		//BRGE/BRLE R0 always jumps
+		if ((branch.opcode == OP_BRGE || branch.opcode == OP_BRLE) && branch.rs1 == 0)
+			continue;
+		if (branch.target <= i + 1 || branch.target > count || branch.target - i - 1 > UINT8_MAX)
+			continue;
+
+		unsigned skipped = 0;
+		size_t position = i + 1;
+		for (; position < branch.target; position++)
+		{
+			const DLXInstruction& instr = instructions[position];
+			if (branchTarget[position] || !canBePredicated(instr))
+				break;
+			if (instr.opcode != OP_NOP && instr.rd != 0)
+				skipped++;
+		}
+		if (position == branch.target && skipped <= maxPredicatedInstructions)
+			branch.predicated = (uint8_t)(branch.target - i - 1);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include "DLXInstruction.h"
+
+//Marks short forward branches
+//      BRGE/BRLE/LOOPCHECK_BRGE/LOOPCHECK_BRLE -> K
+//      up to maxPredicatedInstructions of ADD, ADDI, SUBI, LI, MOV (NOPs are not counted)
+//  K:
+//so that native engines can run the skipped instructions with the inverse
+//condition (predicated instructions, CMOV) instead of branching. The number
+//of skipped instructions is stored in DLXInstruction::predicated of the
+//branch, the instructions themselves are not changed. Branches into the
+//skipped instructions from elsewhere prevent the conversion.
+class DLXIfConverter
+{
+public:
+	static const unsigned maxPredicatedInstructions = 3;
+
+	static void convert(std::vector<DLXInstruction>& instructions);
+};
@@ -0,0 +1,110 @@
+#include "DLXInstruction.h"
+#include <sstream>
+
+using namespace std;
+
+const char* getOpcodeName(DLXOpcode opcode)
+{
+	switch (opcode)
+	{
+	case OP_NOP: return "NOP";
+	case OP_ADD: return "ADD";
+	case OP_ADDI: return "ADDI";
+	case OP_SUBI: return "SUBI";
+	case OP_MULADD: return "MULADD";
+	case OP_LOOPCHECK: return "LOOPCHECK";
+	case OP_LDW: return "LDW";
+	case OP_STW: return "STW";
+	case OP_BRLE: return "BRLE";
+	case OP_BRGE: return "BRGE";
+	case OP_LI: return "LI";
+	case OP_MOV: return "MOV";
+	case OP_COPYW: return "COPYW";
+	case OP_LOOPCHECK_BRLE: return "LOOPCHECK_BRLE";
+	case OP_LOOPCHECK_BRGE: return "LOOPCHECK_BRGE";
+	case OP_DOTW: return "DOTW";
+	case OP_HALT: return "HALT";
+	}
+	return "?";
+}
+
+static void writeImmediate(stringstream& str, int32_t imm)
+{
+	int64_t value = imm;
+	if (value < 0)
+	{
+		str << '-';
+		value = -value;
+	}
+	str << "0x" << std::hex << value << std::dec;
+}
+
+string toString(const DLXInstruction& instr, const string& targetLabel)
+{
+	stringstream str;
+	str << getOpcodeName(instr.opcode);
+
+	switch (instr.opcode)
+	{
+	case OP_ADD:
+	case OP_MULADD:
+		str << "\tR" << (int)instr.rs1 << ", R" << (int)instr.rs2 << ", R" << (int)instr.rd;
+		break;
+	case OP_ADDI:
+	case OP_SUBI:
+	case OP_LOOPCHECK:
+		str << "\tR" << (int)instr.rs1 << ", ";
+		writeImmediate(str, instr.imm);
+		str << ", R" << (int)instr.rd;
+		break;
+	case OP_LDW:
+		str << "\tR" << (int)instr.rd << ", ";
+		writeImmediate(str, instr.imm);
+		str << "(R" << (int)instr.rs1 << ')';
+		break;
+	case OP_STW:
+		str << "\tR" << (int)instr.rs2 << ", ";
+		writeImmediate(str, instr.imm);
+		str << "(R" << (int)instr.rs1 << ')';
+		break;
+	case OP_BRLE:
+	case OP_BRGE:
+		str << "\tR" << (int)instr.rs1 << ", " << targetLabel;
+		break;
+	case OP_LI:
+		str << "\t";
+		writeImmediate(str, instr.imm);
+		str << ", R" << (int)instr.rd;
+		break;
+	case OP_MOV:
+		str << "\tR" << (int)instr.rs1 << ", R" << (int)instr.rd;
+		break;
+	case OP_COPYW:
+		str << "\tR" << (int)instr.rd << ", ";
+		writeImmediate(str, instr.imm);
+		str << "(R" << (int)instr.rs1 << "), ";
+		writeImmediate(str, instr.imm2);
+		str << "(R" << (int)instr.rs2 << ')';
+		break;
+	case OP_LOOPCHECK_BRLE:
+	case OP_LOOPCHECK_BRGE:
+		str << "\tR" << (int)instr.rs1 << ", ";
+		writeImmediate(str, instr.imm);
+		str << ", R" << (int)instr.rd << ", " << targetLabel;
+		break;
+	case OP_DOTW:
+		str << "\tR" << (int)instr.rd << ", ";
+		writeImmediate(str, lowHalf(instr.imm));
+		str << "(R" << (int)instr.rs1 << ") <= ";
+		writeImmediate(str, lowHalf(instr.imm2));
+		str << ", ";
+		writeImmediate(str, highHalf(instr.imm));
+		str << "(R" << (int)instr.rs2 << ") <= ";
+		writeImmediate(str, highHalf(instr.imm2));
+		break;
+	default:
+		break;
+	}
+
+	return str.str();
+}
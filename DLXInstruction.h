@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+enum DLXOpcode : uint8_t
+{
+	OP_NOP,
+	OP_ADD,
+	OP_ADDI,
+	OP_SUBI,
+	OP_MULADD,
+	OP_LOOPCHECK,
+	OP_LDW,
+	OP_STW,
+	OP_BRLE,
+	OP_BRGE,
+	//produced only by DLXPeepholeOptimizer
+	OP_LI,
+	OP_MOV,
+	OP_COPYW,
+	OP_LOOPCHECK_BRLE,
+	OP_LOOPCHECK_BRGE,
+	//produced only by DLXLoopIdiomRecognizer
+	OP_DOTW,
+	OP_HALT //end of program marker, never produced by the loader
+};
+
+//Decoded DLX instruction, the program is kept as a contiguous vector of them.
+//  ADD        rd = rs1 + rs2
+//  ADDI       rd = rs1 + imm
+//  SUBI       rd = rs1 - imm
+//  MULADD     rd = rd + rs1 * rs2
+//  LOOPCHECK  rd = imm - rs1
+//  LDW        rd = mem[rs1 + imm]
+//  STW        mem[rs1 + imm] = rs2
+//  BRLE/BRGE  if rs1 <= 0 / rs1 >= 0 goto target
+//  LI         rd = imm
+//  MOV        rd = rs1
+//  COPYW      rd = mem[rs1 + imm], mem[rs2 + imm2] = rd
+//  LOOPCHECK_BRLE/LOOPCHECK_BRGE
+//             rd = imm - rs1, if rd <= 0 / rd >= 0 goto target
+//  DOTW       k times: rd += mem[rs1 + low(imm)] * mem[rs2 + high(imm)],
+//             rs1 += 4, rs2 += 4 (once if they are the same register);
+//             k is chosen by the engine, 0 included, as long as
+//             low(imm2) - rs1 >= 4k and high(imm2) - rs2 >= 4k
+//rd == 0 means that the result is discarded. target is a position in the
+//instruction vector.
+struct DLXInstruction
+{
+	DLXOpcode opcode;
+	uint8_t rs1;
+	union
+	{
+		uint8_t rs2;
+		//branches only: number of following instructions that the branch skips,
+		//set by DLXIfConverter when they may run predicated instead
+		uint8_t predicated;
+	};
+	uint8_t rd;
+	int32_t imm;
+	union
+	{
+		uint32_t target;
+		int32_t imm2;
+	};
+};
+
+//two signed 16 bit values packed into imm or imm2 of OP_DOTW
+inline int32_t packHalves(int32_t low, int32_t high)
+{
+	return (int32_t)((uint32_t)(uint16_t)high << 16 | (uint16_t)low);
+}
+
+inline int32_t lowHalf(int32_t packed)
+{
+	return (int16_t)(packed & 0xFFFF);
+}
+
+inline int32_t highHalf(int32_t packed)
+{
+	return (int16_t)((uint32_t)packed >> 16);
+}
+
+const char* getOpcodeName(DLXOpcode opcode);
+
+inline bool isBranch(const DLXInstruction& instr)
+{
+	return instr.opcode == OP_BRLE || instr.opcode == OP_BRGE ||
+		instr.opcode == OP_LOOPCHECK_BRLE || instr.opcode == OP_LOOPCHECK_BRGE;
+}
+
+//targetLabel is used only by branches
+std::string toString(const DLXInstruction& instr, const std::string& targetLabel);
@@ -0,0 +1,86 @@
+#include "DLXInstructionDecoder.h"
+#include <cstdio>
+
+using namespace std;
+
+bool DLXInstructionDecoder::isSupported(uint32_t icode)
+{
+	switch (primaryOpcode(icode))
+	{
+	case DLX_SPECIAL:
+		return function(icode) == DLX_FUNC_ADD || icode == 0;
+	case DLX_LDW:
+	case DLX_STW:
+	case DLX_ADDI:
+	case DLX_SUBI:
+	case DLX_BRLE:
+	case DLX_BRGE:
+	case DLX_MULADD:
+	case DLX_LOOPCHECK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool DLXInstructionDecoder::isBranch(uint32_t icode)
+{
+	return primaryOpcode(icode) == DLX_BRLE || primaryOpcode(icode) == DLX_BRGE;
+}
+
+uint32_t DLXInstructionDecoder::branchTarget(uint32_t iaddr, uint32_t icode)
+{
+	return iaddr + 4 + immediate(icode);
+}
+
+DLXInstruction DLXInstructionDecoder::decode(uint32_t icode)
+{
+	DLXInstruction instr = { OP_NOP, 0, 0, 0, 0, 0 };
+
+	switch (primaryOpcode(icode))
+	{
+	case DLX_SPECIAL:
+		if (icode == 0)
+			return instr;
+		if (function(icode) != DLX_FUNC_ADD)
+			break;
+		instr.opcode = OP_ADD;
+		instr.rs1 = rs1(icode);
+		instr.rs2 = rs2(icode);
+		instr.rd = rd(icode);
+		return instr;
+	case DLX_MULADD:
+		instr.opcode = OP_MULADD;
+		instr.rs1 = rs1(icode);
+		instr.rs2 = rs2(icode);
+		instr.rd = rd(icode);
+		return instr;
+	case DLX_ADDI:
+	case DLX_SUBI:
+	case DLX_LOOPCHECK:
+	case DLX_LDW:
+		instr.opcode = primaryOpcode(icode) == DLX_ADDI ? OP_ADDI :
+			primaryOpcode(icode) == DLX_SUBI ? OP_SUBI :
+			primaryOpcode(icode) == DLX_LOOPCHECK ? OP_LOOPCHECK : OP_LDW;
+		instr.rs1 = rs1(icode);
+		instr.rd = rs2(icode);
+		instr.imm = immediate(icode);
+		return instr;
+	case DLX_STW:
+		instr.opcode = OP_STW;
+		instr.rs1 = rs1(icode);
+		instr.rs2 = rs2(icode);
+		instr.imm = immediate(icode);
+		return instr;
+	case DLX_BRLE:
+	case DLX_BRGE:
+		instr.opcode = primaryOpcode(icode) == DLX_BRLE ? OP_BRLE : OP_BRGE;
+		instr.rs1 = rs2(icode);
+		instr.imm = immediate(icode);
+		return instr;
+	}
+
+	char message[64];
+	snprintf(message, sizeof(message), "Unknown DLX machine word: %08X", icode);
+	throw DLXJITException(message);
+}
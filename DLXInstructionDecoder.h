@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include "DLXInstruction.h"
+#include "DLXJITException.h"
+
+//Primary opcodes (bits 31-26) of the DLX machine word.
+//ADD and BRLE do not appear in the reference programs, their encoding follows
+//standard DLX (ADD is SPECIAL with function 0x20) and the BRGE neighbourhood.
+enum DLXPrimaryOpcode
+{
+	DLX_SPECIAL = 0x00,
+	DLX_LDW = 0x03,
+	DLX_STW = 0x06,
+	DLX_ADDI = 0x11,
+	DLX_SUBI = 0x12,
+	DLX_BRLE = 0x1E,
+	DLX_BRGE = 0x1F,
+	DLX_MULADD = 0x22,
+	DLX_LOOPCHECK = 0x23
+};
+
+//Function field (bits 10-0) of SPECIAL instructions
+enum DLXSpecialFunction
+{
+	DLX_FUNC_NOP = 0x00,
+	DLX_FUNC_ADD = 0x20
+};
+
+//Decodes 32 bit DLX machine words.
+//R-type: opcode(6) rs1(5) rs2(5) rd(5) function(11)
+//I-type: opcode(6) rs1(5) rd(5) immediate(16)
+//branch: opcode(6) unused(5) register(5) offset(16), offset is relative to the next instruction
+class DLXInstructionDecoder
+{
+public:
+	static uint8_t primaryOpcode(uint32_t icode) { return icode >> 26; }
+	static uint8_t rs1(uint32_t icode) { return (icode >> 21) & 0x1F; }
+	static uint8_t rs2(uint32_t icode) { return (icode >> 16) & 0x1F; }
+	static uint8_t rd(uint32_t icode) { return (icode >> 11) & 0x1F; }
+	static uint16_t function(uint32_t icode) { return icode & 0x7FF; }
+	static int32_t immediate(uint32_t icode) { return (int16_t)(icode & 0xFFFF); }
+
+	static bool isSupported(uint32_t icode);
+	static bool isBranch(uint32_t icode);
+	static uint32_t branchTarget(uint32_t iaddr, uint32_t icode);
+
+	//branch target is left for the caller to resolve from branchTarget()
+	static DLXInstruction decode(uint32_t icode);
+};
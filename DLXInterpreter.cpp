@@ -0,0 +1,238 @@
+/*
+ * File:   DLXInterpreter.cpp
+ *
+ * Threaded-dispatch interpreter. Decoded instructions are executed with
+ * computed goto (GCC labels as values).
+ */
+
+#include "DLXInterpreter.h"
+#include <endian.h>
+#include <cstring>
+#include <algorithm>
+#include "utils.h"
+
+using namespace std;
+
+DLXInterpreter::DLXInterpreter()
+{
+}
+
+shared_ptr<const DLXCompiledProgram> DLXInterpreter::compile() {
+    InstructionCollection optimized;
+    SourcePositions sourcePositions;
+    optimizeInstructions(optimized, sourcePositions);
+
+    //NOPs are dropped, so branch targets are moved to the next remaining instruction
+    vector<InstructionCollection::size_type> newPositions(optimized.size() + 1);
+    InstructionCollection ops;
+    ops.reserve(optimized.size() + 1);
+    vector<uint32_t> opAddresses;
+    opAddresses.reserve(optimized.size() + 1);
+    for (InstructionCollection::size_type i = 0; i < optimized.size(); i++)
+    {
+        DLXInstruction& instr = optimized[i];
+        //writing to R0 is not allowed, so such instructions do nothing
+        if (instr.rd == 0 && instr.opcode != OP_STW && !isBranch(instr))
+            instr.opcode = OP_NOP;
+        //fused branches always write their result, a discarded one goes to the spare slot
+        if (instr.rd == 0 && (instr.opcode == OP_LOOPCHECK_BRLE || instr.opcode == OP_LOOPCHECK_BRGE))
+            instr.rd = numberOfDLXRegisters;
+        newPositions[i] = ops.size();
+        if (instr.opcode == OP_NOP)
+            continue;
+        ops.push_back(instr);
+        opAddresses.push_back(codContent[sourcePositions[i]].iaddr);
+    }
+    newPositions[optimized.size()] = ops.size();
+
+    DLXInstruction halt = { OP_HALT, 0, 0, 0, 0, 0 };
+    ops.push_back(halt);
+    opAddresses.push_back(0);
+
+    for (auto& op : ops)
+    {
+        if (isBranch(op))
+            op.target = newPositions[op.target];
+    }
+    return make_shared<DLXInterpretedProgram>(context.getDataMemory().getByteOrder(), getDataMemoryFootprint(), move(ops), move(opAddresses), finalRegistersKept);
+}
+
+DLXInterpreter::~DLXInterpreter() {
+}
+
+void DLXInterpreter::setExecutionCounting(DLXExecutionCounting counting) {
+    if (counting != COUNT_NOTHING)
+        throw DLXJITException("Executions are not counted by the interpreter");
+    DLXJIT::setExecutionCounting(counting);
+}
+
+DLXInterpretedProgram::DLXInterpretedProgram(DLXDataByteOrder byteOrder, size_t dataMemorySize, InstructionCollection&& ops, vector<uint32_t>&& opAddresses, bool finalRegistersKept)
+    : DLXCompiledProgram(byteOrder, dataMemorySize), ops(move(ops)), opAddresses(move(opAddresses)), finalRegistersKept(finalRegistersKept)
+{
+}
+
+void DLXInterpretedProgram::execute(DLXExecutionContext& context) const {
+    prepareContext(context);
+    //one spare slot for discarded results
+    const int numberOfRegisters = DLXExecutionContext::numberOfRegisters;
+    uint32_t regs[numberOfRegisters + 1];
+    memcpy(regs, context.getRegisters(), numberOfRegisters * sizeof(uint32_t));
+    interpret<false>(context, regs, 0, nullptr, 0);
+    if (finalRegistersKept)
+        memcpy(context.getRegisters(), regs, numberOfRegisters * sizeof(uint32_t));
+}
+
+template<bool counted>
+size_t DLXInterpretedProgram::interpret(DLXExecutionContext& context, uint32_t* regs, size_t start, uint32_t* counters, uint32_t threshold) const {
+    //order has to match DLXOpcode
+    static const void* dispatchTable[] = {
+        &&do_nop,
+        &&do_add,
+        &&do_addi,
+        &&do_subi,
+        &&do_muladd,
+        &&do_loopcheck,
+        &&do_ldw,
+        &&do_stw,
+        &&do_brle,
+        &&do_brge,
+        &&do_li,
+        &&do_mov,
+        &&do_copyw,
+        &&do_loopcheck_brle,
+        &&do_loopcheck_brge,
+        &&do_dotw,
+        &&do_halt
+    };
+
+    regs[0] = 0;
+    DLXDataMemory& dataMemory = context.getDataMemory();
+    uint8_t* memory = dataMemory.data();
+    const std::size_t memorySize = dataMemory.size();
+    const bool byteSwapData = dataMemory.isByteSwapNeeded();
+    const DLXInstruction* const program = ops.data();
+    const DLXInstruction* op = program + start;
+    const DLXInstruction* from;
+    std::size_t address;
+    uint32_t word;
+
+#define DISPATCH() goto *dispatchTable[op->opcode]
+#define NEXT() do { ++op; DISPATCH(); } while (0)
+#define CHECK_ADDRESS(address) do { if ((address) + 4 > memorySize) goto out_of_range; } while (0)
+#define BRANCH() do { \
+        from = op; \
+        op = program + op->target; \
+        if (counted && op <= from && ++counters[op - program] >= threshold) \
+            return op - program; \
+        DISPATCH(); \
+    } while (0)
+
+    DISPATCH();
+
+do_nop:
+    NEXT();
+do_add:
+    regs[op->rd] = regs[op->rs1] + regs[op->rs2];
+    NEXT();
+do_addi:
+    regs[op->rd] = regs[op->rs1] + op->imm;
+    NEXT();
+do_subi:
+    regs[op->rd] = regs[op->rs1] - op->imm;
+    NEXT();
+do_muladd:
+    regs[op->rd] += regs[op->rs1] * regs[op->rs2];
+    NEXT();
+do_loopcheck:
+    regs[op->rd] = op->imm - regs[op->rs1];
+    NEXT();
+do_ldw:
+    address = (uint32_t)(regs[op->rs1] + op->imm);
+    CHECK_ADDRESS(address);
+    memcpy(&word, memory + address, sizeof(word));
+    regs[op->rd] = byteSwapData ? __builtin_bswap32(word) : word;
+    NEXT();
+do_stw:
+    address = (uint32_t)(regs[op->rs1] + op->imm);
+    CHECK_ADDRESS(address);
+    word = byteSwapData ? __builtin_bswap32(regs[op->rs2]) : regs[op->rs2];
+    memcpy(memory + address, &word, sizeof(word));
+    NEXT();
+do_brle:
+    if ((int32_t)regs[op->rs1] <= 0)
+        BRANCH();
+    NEXT();
+do_brge:
+    if ((int32_t)regs[op->rs1] >= 0)
+        BRANCH();
+    NEXT();
+do_li:
+    regs[op->rd] = op->imm;
+    NEXT();
+do_mov:
+    regs[op->rd] = regs[op->rs1];
+    NEXT();
+do_copyw:
+    //word is copied as it is, only the register value is converted
+    address = (uint32_t)(regs[op->rs1] + op->imm);
+    CHECK_ADDRESS(address);
+    memcpy(&word, memory + address, sizeof(word));
+    regs[op->rd] = byteSwapData ? __builtin_bswap32(word) : word;
+    address = (uint32_t)(regs[op->rs2] + op->imm2);
+    CHECK_ADDRESS(address);
+    memcpy(memory + address, &word, sizeof(word));
+    NEXT();
+do_loopcheck_brle:
+    regs[op->rd] = op->imm - regs[op->rs1];
+    if ((int32_t)regs[op->rd] <= 0)
+        BRANCH();
+    NEXT();
+do_loopcheck_brge:
+    regs[op->rd] = op->imm - regs[op->rs1];
+    if ((int32_t)regs[op->rd] >= 0)
+        BRANCH();
+    NEXT();
+do_dotw:
+    {
+        //all iterations before the loop exit or a wrap, the loop reports accesses out of range itself
+        int32_t left = std::min((int32_t)(lowHalf(op->imm2) - regs[op->rs1]), (int32_t)(highHalf(op->imm2) - regs[op->rs2]));
+        if (left < 4)
+            NEXT();
+        std::size_t length = (std::size_t)(left / 4) * 4;
+        std::size_t addressA = (uint32_t)(regs[op->rs1] + lowHalf(op->imm));
+        std::size_t addressB = (uint32_t)(regs[op->rs2] + highHalf(op->imm));
+        if (addressA + length > memorySize || addressB + length > memorySize)
+            NEXT();
+        uint32_t sum = 0;
+        for (std::size_t i = 0; i < length; i += 4)
+        {
+            uint32_t wordA, wordB;
+            memcpy(&wordA, memory + addressA + i, sizeof(wordA));
+            memcpy(&wordB, memory + addressB + i, sizeof(wordB));
+            if (byteSwapData)
+            {
+                wordA = __builtin_bswap32(wordA);
+                wordB = __builtin_bswap32(wordB);
+            }
+            sum += wordA * wordB;
+        }
+        regs[op->rd] += sum;
+        regs[op->rs1] += length;
+        if (op->rs2 != op->rs1)
+            regs[op->rs2] += length;
+    }
+    NEXT();
+do_halt:
+    return ops.size();
+
+out_of_range:
+    throw DLXMemoryAccessException(opAddresses[op - program], (uint32_t)address);
+
+#undef BRANCH
+#undef CHECK_ADDRESS
+#undef NEXT
+#undef DISPATCH
+}
+
+template size_t DLXInterpretedProgram::interpret<false>(DLXExecutionContext& context, uint32_t* regs, size_t start, uint32_t* counters, uint32_t threshold) const;
+template size_t DLXInterpretedProgram::interpret<true>(DLXExecutionContext& context, uint32_t* regs, size_t start, uint32_t* counters, uint32_t threshold) const;
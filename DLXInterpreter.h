@@ -0,0 +1,42 @@
+/*
+ * File:   DLXInterpreter.h
+ *
+ * Portable DLX engine for hosts where generating native code is not
+ * possible (unsupported architecture, W^X enforcing kernels, sandboxes).
+ */
+#pragma once
+#include "DLXJIT.h"
+#include <vector>
+
+class DLXInterpreter : public DLXJIT {
+public:
+    DLXInterpreter();
+
+    ~DLXInterpreter() override;
+    //only native code counts executions
+    void setExecutionCounting(DLXExecutionCounting counting) override;
+private:
+    std::shared_ptr<const DLXCompiledProgram> compile() override;
+};
+
+//Decoded program run by DLXInterpreter
+class DLXInterpretedProgram : public DLXCompiledProgram {
+public:
+    typedef std::vector<DLXInstruction> InstructionCollection;
+
+    //ops end with OP_HALT, opAddresses holds the DLX address of every op for error messages
+    DLXInterpretedProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, InstructionCollection&& ops, std::vector<uint32_t>&& opAddresses, bool finalRegistersKept);
+
+    void execute(DLXExecutionContext& context) const override;
+protected:
+    //runs ops from start with regs (one spare slot after the DLX registers) and returns
+    //ops.size() at the end of the program. When counted, every taken backward branch
+    //increments the counter of its target; once one reaches threshold, the position
+    //of the target is returned before it runs.
+    template<bool counted>
+    std::size_t interpret(DLXExecutionContext& context, uint32_t* regs, std::size_t start, uint32_t* counters, uint32_t threshold) const;
+
+    const InstructionCollection ops;
+    const std::vector<uint32_t> opAddresses;
+    const bool finalRegistersKept;
+};
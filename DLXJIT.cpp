@@ -2,20 +2,176 @@
 #include <iostream>
 #include <string>
 #include <sstream>
-#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
+#include <endian.h>
 #include "utils.h"
+#include "DLXDatFile.h"
+#include "DLXMemoryImage.h"
+#include "DLXIfConverter.h"
+#include "DLXInstructionDecoder.h"
+#include "DLXLoopIdiomRecognizer.h"
+#include "DLXLoopUnroller.h"
+#include "DLXMemoryFootprintAnalysis.h"
+#include "DLXPeepholeOptimizer.h"
+#include "DLXPerfMap.h"
+#include "DLXTextInstruction.h"
+#include "DLXInterpreter.h"
+#include "DLXTieredProgram.h"
 
 #if defined(__arm__)
 #include "DLXJITArm7.h"
-#else
-#error "No implementation for current architecture"
+#elif defined(__x86_64__)
+#include "DLXJITX64.h"
 #endif
 
 using namespace std;
 
 DLXJIT::DLXJIT()
-	: numberOfDLXRegisters(32)
+	: numberOfDLXRegisters(DLXExecutionContext::numberOfRegisters), loopUnrollFactor(4), finalRegistersKept(false),
+	entryPosition(0), tieringThreshold(0), lazyCompilation(false), executionCounting(COUNT_NOTHING),
+	dataMemoryFootprint(0), dataMemoryFootprintKnown(false)
+{
+}
+
+DLXJIT::DLXJIT(const DLXJIT& other)
+	: enable_shared_from_this<DLXJIT>(), numberOfDLXRegisters(other.numberOfDLXRegisters), codContent(other.codContent),
+	instructions(other.instructions), labelDictionary(other.labelDictionary), context(other.context.getDataMemory().getByteOrder()),
+	loopUnrollFactor(other.loopUnrollFactor), finalRegistersKept(other.finalRegistersKept), codeCacheDirectory(other.codeCacheDirectory),
+	entryPosition(other.entryPosition), tieringThreshold(other.tieringThreshold), lazyCompilation(other.lazyCompilation),
+	executionCounting(other.executionCounting), dataMemoryFootprint(other.dataMemoryFootprint),
+	dataMemoryFootprintKnown(other.dataMemoryFootprintKnown)
+{
+}
+
+static uint8_t getDLXRegisterNumber(const std::string& name)
 {
+	if (!isRegisterName(name))
+		throw DLXJITException(("Invalid register name: " + name).c_str());
+
+	int number = stoi(name.substr(1));
+	if (number > UINT8_MAX)
+		throw DLXJITException(("Invalid register name: " + name).c_str());
+	return number;
+}
+
+//Fallback for instructions whose machine word is unknown to DLXInstructionDecoder
+static DLXInstruction convertTextInstruction(const shared_ptr<DLXTextInstruction>& textInstruction, string& branchLabel)
+{
+	DLXInstruction instr = { OP_NOP, 0, 0, 0, 0, 0 };
+	const string& opcode = textInstruction->opcode();
+
+	if (opcode == "ADD" || opcode == "MULADD")
+	{
+		shared_ptr<DLXRTypeTextInstruction> text = dynamic_pointer_cast<DLXRTypeTextInstruction>(textInstruction);
+		instr.opcode = opcode == "ADD" ? OP_ADD : OP_MULADD;
+		instr.rs1 = getDLXRegisterNumber(text->reg(0));
+		instr.rs2 = getDLXRegisterNumber(text->reg(1));
+		instr.rd = getDLXRegisterNumber(text->reg(2));
+	}
+	else if (opcode == "ADDI" || opcode == "SUBI" || opcode == "LOOPCHECK")
+	{
+		shared_ptr<DLXITypeTextInstruction> text = dynamic_pointer_cast<DLXITypeTextInstruction>(textInstruction);
+		instr.opcode = opcode == "ADDI" ? OP_ADDI : opcode == "SUBI" ? OP_SUBI : OP_LOOPCHECK;
+		instr.rs1 = getDLXRegisterNumber(text->reg(0));
+		instr.rd = getDLXRegisterNumber(text->reg(1));
+		instr.imm = text->immediate();
+	}
+	else if (opcode == "LDW" || opcode == "STW")
+	{
+		shared_ptr<DLXMTypeTextInstruction> text = dynamic_pointer_cast<DLXMTypeTextInstruction>(textInstruction);
+		instr.opcode = opcode == "LDW" ? OP_LDW : OP_STW;
+		instr.rs1 = getDLXRegisterNumber(text->indexRegister());
+		if (instr.opcode == OP_LDW)
+			instr.rd = getDLXRegisterNumber(text->dataRegister());
+		else
+			instr.rs2 = getDLXRegisterNumber(text->dataRegister());
+		instr.imm = text->baseAddress();
+	}
+	else if (opcode == "BRLE" || opcode == "BRGE")
+	{
+		shared_ptr<DLXJTypeTextInstruction> text = dynamic_pointer_cast<DLXJTypeTextInstruction>(textInstruction);
+		instr.opcode = opcode == "BRLE" ? OP_BRLE : OP_BRGE;
+		instr.rs1 = getDLXRegisterNumber(text->branchRegister());
+		branchLabel = text->label();
+	}
+	else if (opcode != "NOP")
+	{
+		string message = "Unsupported DLX opcode: " + opcode;
+		throw DLXJITException(message.c_str());
+	}
+
+	return instr;
+}
+
+void DLXJIT::addCodLine(uint32_t iaddr, uint32_t icode, std::string&& label, const DLXInstruction& instruction)
+{
+	if (instruction.rs1 >= numberOfDLXRegisters || instruction.rs2 >= numberOfDLXRegisters || instruction.rd >= numberOfDLXRegisters)
+		throw DLXJITException("Invalid register number in: " + toString(instruction, ""));
+
+	DLXJITCodLine codLine = { iaddr, icode, std::move(label) };
+	codContent.push_back(std::move(codLine));
+	instructions.push_back(instruction);
+
+	auto last = codContent.size() - 1;
+	if (codContent[last].label != "")
+	{
+		labelDictionary[codContent[last].label] = last;
+	}
+}
+
+DLXJIT::CodCollection::size_type DLXJIT::getPositionForAddress(uint32_t iaddr)
+{
+	//code is stored in address order, usually without gaps
+	CodCollection::size_type guess = (iaddr - codContent.front().iaddr) / 4;
+	if (guess < codContent.size() && codContent[guess].iaddr == iaddr)
+		return guess;
+
+	auto it = lower_bound(codContent.begin(), codContent.end(), iaddr,
+		[](const DLXJITCodLine& line, uint32_t address) { return line.iaddr < address; });
+	if (it == codContent.end() || it->iaddr != iaddr)
+	{
+		stringstream message;
+		message << "No instruction at address 0x" << std::hex << iaddr;
+		throw DLXJITException(message.str());
+	}
+	return it - codContent.begin();
+}
+
+void DLXJIT::resolveBranchTargets(const BranchLabels& branchLabels)
+{
+	//the loaded program is complete, the footprint of an earlier one is gone
+	dataMemoryFootprintKnown = false;
+	for (InstructionCollection::size_type i = 0; i < instructions.size(); i++)
+	{
+		if (!isBranch(instructions[i]))
+			continue;
+
+		auto labelled = branchLabels.find(i);
+		if (labelled != branchLabels.end())
+		{
+			instructions[i].target = getPositionForLabel(labelled->second);
+			continue;
+		}
+
+		auto target = getPositionForAddress(DLXInstructionDecoder::branchTarget(codContent[i].iaddr, codContent[i].icode));
+		if (codContent[target].label == "")
+		{
+			char label[16];
+			snprintf(label, sizeof(label), "L_%04X", codContent[target].iaddr);
+			codContent[target].label = label;
+			labelDictionary[codContent[target].label] = target;
+		}
+		instructions[i].target = target;
+	}
+}
+
+std::string DLXJIT::instructionToString(InstructionCollection::size_type position)
+{
+	const DLXInstruction& instr = instructions[position];
+	return toString(instr, isBranch(instr) ? codContent[instr.target].label : "");
 }
 
 void DLXJIT::loadCode(istream& codStream)
@@ -25,72 +181,64 @@ void DLXJIT::loadCode(istream& codStream)
 	if (line != "[Code Memory Content]")
 		throw DLXJITException("Invalid cod file");
 
+	BranchLabels branchLabels;
 	while (getline(codStream, line))
 	{
-		stringstream linestream(line);
-		string iaddr, icode, label, itext;
+		//iaddr: icode | label | itext
+		auto addressEnd = line.find(':');
+		auto codeEnd = line.find('|', addressEnd);
+		auto labelEnd = line.find('|', codeEnd + 1);
+		if (addressEnd == string::npos || codeEnd == string::npos || labelEnd == string::npos)
+		{
+			if (line.find_first_not_of(" \r\t") == string::npos)
+				continue;
+			throw DLXJITException("Invalid cod line: " + line);
+		}
 
-		getline(linestream, iaddr, ':');
-		trim(iaddr);
-		getline(linestream, icode, '|');
-		trim(icode);
-		getline(linestream, label, '|');
+		uint32_t iaddr = strtoul(line.c_str(), nullptr, 16);
+		uint32_t icode = strtoul(line.c_str() + addressEnd + 1, nullptr, 16);
+		string label = line.substr(codeEnd + 1, labelEnd - codeEnd - 1);
 		trim(label);
-		getline(linestream, itext);
-		trim(itext);
-
-		DLXJITCodLine codLine = { stoul(iaddr, nullptr, 16), stoul(icode, nullptr, 16), std::move(label), DLXTextInstruction::parse(itext)};
-		codContent.push_back(std::move(codLine));
 
-		auto last = codContent.size() - 1;
-		if (codContent[last].label != "")
+		DLXInstruction instruction;
+		if (DLXInstructionDecoder::isSupported(icode))
+		{
+			instruction = DLXInstructionDecoder::decode(icode);
+		}
+		else
 		{
-			labelDictionary[codContent[last].label] = last;
+			string itext = line.substr(labelEnd + 1);
+			trim(itext);
+			string branchLabel;
+			instruction = convertTextInstruction(DLXTextInstruction::parse(itext), branchLabel);
+			if (isBranch(instruction))
+				branchLabels[instructions.size()] = branchLabel;
 		}
+
+		addCodLine(iaddr, icode, std::move(label), instruction);
 	}
 
+	resolveBranchTargets(branchLabels);
 }
 
-enum DLXDatRepresentationSize
-{
-	BYTE = 0,
-	HALF = 1,
-	WORD = 2
-};
-
-enum DLXDatRepresentationFormatBase
+void DLXJIT::loadBinaryCode(istream& codeStream)
 {
-	UNSIGNED_HEXADECIMAL = 0,
-	UNSIGNED_DECIMAL = 1,
-	SIGNED_DECIMAL = 2
-};
-
+	vector<char> image((istreambuf_iterator<char>(codeStream)), istreambuf_iterator<char>());
+	if (image.size() % 4 != 0)
+		throw DLXJITException("Invalid binary code image size");
 
-template<typename N = uint32_t>
-void readDataFromDatFile(std::istream& datStream, std::function<void(std::size_t, N)> saveInmemory, bool hexFormat)
-{
-	string line;
-	while (getline(datStream, line))
+	codContent.reserve(image.size() / 4);
+	instructions.reserve(image.size() / 4);
+	for (size_t address = 0; address < image.size(); address += 4)
 	{
-		stringstream lineStream(line);
-		
-		if (hexFormat)
-			lineStream >> std::hex;
-
-		int64_t buf;
-		lineStream >> buf;
-		std::size_t address = buf;
+		uint32_t icode;
+		memcpy(&icode, &image[address], sizeof(icode));
+		icode = be32toh(icode);
 
-		char ignore;
-		lineStream >> ignore;
-
-		for (int i = 0; i < 8; i++)
-		{
-			lineStream >> buf;
-			saveInmemory(address, (N)buf);
-			address += sizeof(N);
-		}
+		addCodLine(address, icode, "", DLXInstructionDecoder::decode(icode));
 	}
+
+	resolveBranchTargets(BranchLabels());
 }
 
 DLXJIT::CodCollection::size_type DLXJIT::getPositionForLabel(const std::string& label) {
@@ -105,92 +253,306 @@ DLXJIT::CodCollection::size_type DLXJIT::getPositionForLabel(const std::string&
 
 void DLXJIT::loadData(std::istream& datStream)
 {
-	string line;
-	getline(datStream, line);
-	if (line != "[Data Memory]")
-		throw DLXJITException("Invalid dat file");
+	loadData(datStream, context.getDataMemory());
+}
 
-	DLXDatRepresentationSize size = WORD;
-	DLXDatRepresentationFormatBase base = UNSIGNED_HEXADECIMAL;
+void DLXJIT::saveData(std::ostream& datStream)
+{
+	saveData(datStream, context.getDataMemory());
+}
 
-	const string sizeKey = "Size=";
-	const string baseKey = "Base=";
+void DLXJIT::loadData(std::istream& datStream, DLXDataMemory& memory)
+{
+	string text((istreambuf_iterator<char>(datStream)), istreambuf_iterator<char>());
+	DLXDatFile::parse(text.data(), text.size(), memory);
+}
 
-	while (getline(datStream, line) && line != "[Data Memory Content]")
+void DLXJIT::saveData(std::ostream& datStream, DLXDataMemory& memory)
+{
+	string text;
+	DLXDatFile::format(memory, text);
+	datStream.write(text.data(), text.size());
+}
+
+void DLXJIT::loadDataFile(const std::string& fileName, DLXDataMemory& memory)
+{
+	if (DLXMemoryImage::isImage(fileName))
+		DLXMemoryImage::load(fileName, memory);
+	else
+		DLXDatFile::load(fileName, memory);
+}
+
+void DLXJIT::saveDataFile(const std::string& fileName, DLXDataMemory& memory)
+{
+	if (DLXMemoryImage::isImageName(fileName))
+		DLXMemoryImage::save(fileName, memory);
+	else
+		DLXDatFile::save(fileName, memory);
+}
+
+std::size_t DLXJIT::getDataMemorySize()
+{
+	return context.getDataMemory().size();
+}
+
+shared_ptr<const DLXCompiledProgram> DLXJIT::getCompiledProgram()
+{
+	if (compiledProgram)
+		return compiledProgram;
+	//the interpreter does not count
+	if (tieringThreshold == 0 || executionCounting != COUNT_NOTHING)
 	{
-		if (line.compare(0, sizeKey.size(), sizeKey) == 0)
-		{
-			size = (DLXDatRepresentationSize)stol(line.substr(sizeKey.size()));
-		}
-		else if (line.compare(0, baseKey.size(), baseKey) == 0)
-		{
-			base = (DLXDatRepresentationFormatBase)stol(line.substr(baseKey.size()));
-		}
+		compiledProgram = compile();
+		return compiledProgram;
+	}
+	vector<uint32_t> addresses;
+	addresses.reserve(codContent.size());
+	for (const auto& line : codContent)
+		addresses.push_back(line.iaddr);
+	//without an owner the program stays in the interpreter
+	weak_ptr<DLXJIT> compiler;
+	try
+	{
+		compiler = shared_from_this();
+	}
+	catch (bad_weak_ptr&)
+	{
+	}
+	compiledProgram = make_shared<DLXTieredProgram>(context.getDataMemory().getByteOrder(), getDataMemoryFootprint(),
+		instructions, move(addresses), finalRegistersKept, tieringThreshold, compiler);
+	return compiledProgram;
+}
+
+shared_ptr<const DLXCompiledProgram> DLXJIT::compileFrom(InstructionCollection::size_type position)
+{
+	//only the blocks reached from the loop header are generated, on backends that generate lazily
+	bool lazy = lazyCompilation;
+	entryPosition = position;
+	lazyCompilation = true;
+	try
+	{
+		auto program = compile();
+		entryPosition = 0;
+		lazyCompilation = lazy;
+		return program;
 	}
+	catch (...)
+	{
+		entryPosition = 0;
+		lazyCompilation = lazy;
+		throw;
+	}
+}
 
-	if (datStream.eof() || line != "[Data Memory Content]")
-		throw DLXJITException("Invalid dat file - no content");
+void DLXJIT::execute()
+{
+	getCompiledProgram()->execute(context);
+}
 
+void DLXJIT::setFinalRegistersKept(bool kept)
+{
+	finalRegistersKept = kept;
+}
 
-	const bool isHexEnabled = base == UNSIGNED_HEXADECIMAL;
+uint32_t DLXJIT::getRegistersLiveOnExit() const
+{
+	//R0 is never live
+	return finalRegistersKept ? ~(uint32_t)1 : 0;
+}
 
-	switch (size)
+size_t DLXJIT::getDataMemoryFootprint() const
+{
+	//every compile of the program needs it, tiered programs compile once more per entry
+	if (!dataMemoryFootprintKnown)
 	{
-	case BYTE:
-		readDataFromDatFile<uint8_t>(datStream, [=](std::size_t a, uint8_t value) {return this->saveByteInMemory(a,value); }, isHexEnabled);
-		break;
-	case HALF:
-		readDataFromDatFile<uint16_t>(datStream, [=](std::size_t a, uint16_t value) {return this->saveHalfInMemory(a, value); }, isHexEnabled);
-		break;
-	default:
-	case WORD:
-		readDataFromDatFile<uint32_t>(datStream, [=](std::size_t a, uint32_t value) {return this->saveWordInMemory(a, value); }, isHexEnabled);
-		break;
+		dataMemoryFootprint = DLXMemoryFootprintAnalysis(instructions).getSize();
+		dataMemoryFootprintKnown = true;
 	}
+	return dataMemoryFootprint;
+}
 
+void DLXJIT::setDataMemoryFootprint(size_t footprint)
+{
+	dataMemoryFootprint = footprint;
+	dataMemoryFootprintKnown = true;
 }
 
-void DLXJIT::saveData(std::ostream& datStream)
+void DLXJIT::setTieringThreshold(unsigned iterations)
 {
-	datStream << "[Data Memory]" << endl;
-	datStream << "Size=" << WORD << endl;
-	datStream << "Base=" << UNSIGNED_HEXADECIMAL << endl << endl;
+	tieringThreshold = iterations;
+}
+
+void DLXJIT::setLazyCompilation(bool lazy)
+{
+	lazyCompilation = lazy;
+}
 
-	datStream << "[Data Memory Content]" << endl;
-	auto size = getDataMemorySize();
+void DLXJIT::setExecutionCounting(DLXExecutionCounting counting)
+{
+	executionCounting = counting;
+}
 
-	datStream << std::hex;
-	datStream.fill('0');
+vector<bool> DLXJIT::getCountedPositions() const
+{
+	if (executionCounting != COUNT_BLOCKS)
+		return vector<bool>(instructions.size(), executionCounting == COUNT_INSTRUCTIONS);
+	return getBlockStarts();
+}
 
-	for (size_t address = 0; address < size; address += 4)
+vector<bool> DLXJIT::getBlockStarts() const
+{
+	vector<bool> blockStarts(instructions.size() + 1, false);
+	blockStarts[0] = true;
+	for (InstructionCollection::size_type i = 0; i < instructions.size(); i++)
 	{
-		if (address % (8 * 4) == 0)
+		if (isBranch(instructions[i]))
 		{
-			datStream.width(3);
-			datStream << address << ':';
+			blockStarts[instructions[i].target] = true;
+			blockStarts[i + 1] = true;
 		}
+	}
+	blockStarts.pop_back();
+	return blockStarts;
+}
+
+string DLXJIT::getCodeName(InstructionCollection::size_type position) const
+{
+	const auto& line = codContent[position];
+	char address[16];
+	snprintf(address, sizeof(address), "0x%04X", line.iaddr);
+	return "dlx:" + (line.label.empty() ? "" : line.label + "@") + address;
+}
+
+void DLXJIT::addToPerfMap(const uint8_t* code, size_t size, const vector<size_t>& offsets, const SourcePositions& sourcePositions) const
+{
+	DLXPerfMap& perfMap = DLXPerfMap::instance();
+	if (!perfMap.isOpen())
+		return;
+	auto blockStarts = getBlockStarts();
+	size_t start = 0;
+	string name = "dlx:entry";
+	for (SourcePositions::size_type i = 0; i < offsets.size(); i++)
+	{
+		//a range ends where the source order breaks too, as between copies made by unrolling
+		bool exit = i >= sourcePositions.size();
+		if (!exit && i > 0 && !blockStarts[sourcePositions[i]] && sourcePositions[i - 1] + 1 == sourcePositions[i])
+			continue;
+		if (offsets[i] > start)
+			perfMap.add(code + start, offsets[i] - start, name);
+		start = offsets[i];
+		name = exit ? "dlx:exit" : getCodeName(sourcePositions[i]);
+	}
+	if (size > start)
+		perfMap.add(code + start, size - start, name);
+}
+
+void DLXJIT::printHotspots(ostream& out, size_t lines)
+{
+	const auto& counts = context.getExecutionCounts();
+	auto counted = getCountedPositions();
+	//instructions of a block run as often as its first one
+	vector<uint64_t> executions(instructions.size(), 0);
+	uint64_t total = 0;
+	uint64_t blockExecutions = 0;
+	for (InstructionCollection::size_type i = 0; i < instructions.size(); i++)
+	{
+		if (counted[i])
+			blockExecutions = i < counts.size() ? counts[i] : 0;
+		executions[i] = blockExecutions;
+		total += blockExecutions;
+	}
 
-		datStream.width(0);
-		datStream << "  ";
-		datStream.width(8);
-		datStream << this->loadWordFromMemory(address);
+	vector<InstructionCollection::size_type> order;
+	for (InstructionCollection::size_type i = 0; i < instructions.size(); i++)
+	{
+		if (executions[i] > 0)
+			order.push_back(i);
+	}
+	stable_sort(order.begin(), order.end(),
+		[&executions](InstructionCollection::size_type a, InstructionCollection::size_type b) { return executions[a] > executions[b]; });
+	if (lines > 0 && order.size() > lines)
+		order.resize(lines);
+
+	out << "  executions   share  address  instruction" << endl;
+	for (auto position : order)
+	{
+		const auto& line = codContent[position];
+		char prefix[64];
+		snprintf(prefix, sizeof(prefix), "%12llu %6.2f%%  0x%04X   ", (unsigned long long)executions[position],
+			100.0 * executions[position] / total, line.iaddr);
+		string text = instructionToString(position);
+		replace(text.begin(), text.end(), '\t', ' ');
+		out << prefix << (line.label.empty() ? "" : line.label + ": ") << text << endl;
+	}
+}
 
-		if (address % (8 * 4) == (7 * 4 ))
+void DLXJIT::setDataByteOrder(DLXDataByteOrder order)
+{
+	context.getDataMemory().setByteOrder(order);
+}
+
+void DLXJIT::setLoopUnrollFactor(unsigned factor)
+{
+	loopUnrollFactor = factor;
+}
+
+void DLXJIT::setCodeCacheDirectory(const std::string& directory)
+{
+	codeCacheDirectory = directory;
+}
+
+void DLXJIT::optimizeInstructions(InstructionCollection& optimized, SourcePositions& sourcePositions)
+{
+	optimized = instructions;
+	sourcePositions.resize(optimized.size());
+	for (InstructionCollection::size_type i = 0; i < optimized.size(); i++)
+		sourcePositions[i] = i;
+	if (entryPosition > 0)
+	{
+		//an always taken branch in front leads to the entry
+		for (auto& instr : optimized)
 		{
-			datStream << endl;
+			if (isBranch(instr))
+				instr.target++;
 		}
+		DLXInstruction jump = { OP_BRGE, 0, 0, 0, 0, 0 };
+		jump.target = entryPosition + 1;
+		optimized.insert(optimized.begin(), jump);
+		sourcePositions.insert(sourcePositions.begin(), entryPosition);
 	}
+	//fused branches would leave the code of the second instruction to fall through only
+	if (executionCounting != COUNT_NOTHING)
+		return;
+	size_t size = optimized.size();
+	DLXPeepholeOptimizer::optimize(optimized, getRegistersLiveOnExit());
+	DLXLoopIdiomRecognizer::recognize(optimized, sourcePositions);
+	DLXLoopUnroller::unroll(optimized, sourcePositions, loopUnrollFactor);
+	//results of intermediate loop checks are overwritten by the next copy
+	if (optimized.size() != size)
+		DLXPeepholeOptimizer::optimize(optimized, getRegistersLiveOnExit());
+	//last, earlier passes do not keep DLXInstruction::predicated up to date
+	DLXIfConverter::convert(optimized);
 }
 
 DLXJIT::~DLXJIT()
 {
 }
 
-shared_ptr<DLXJIT> DLXJIT::createInstance()
+shared_ptr<DLXJIT> DLXJIT::createInstance(DLXJITEngine engine)
 {
+        if (engine == INTERPRETER)
+                return shared_ptr<DLXJIT>(new DLXInterpreter());
+#if defined(__arm__) || defined(__x86_64__)
 #if defined(__arm__)
-        return shared_ptr<DLXJIT>(new DLXJITArm7());
+        shared_ptr<DLXJIT> instance(new DLXJITArm7());
+#else
+        shared_ptr<DLXJIT> instance(new DLXJITX64());
+#endif
+        if (engine == TIERED)
+                instance->setTieringThreshold(defaultTieringThreshold);
+        return instance;
 #else
-#error "No implementation for current architecture"
+        //no native code generator for current architecture
+        return shared_ptr<DLXJIT>(new DLXInterpreter());
 #endif
 }
\ No newline at end of file
@@ -4,7 +4,10 @@
 #include <vector>
 #include <map>
 #include <cstdint>
-#include "DLXTextInstruction.h"
+#include "DLXInstruction.h"
+#include "DLXDataMemory.h"
+#include "DLXCompiledProgram.h"
+#include "DLXExecutionContext.h"
 #include "DLXJITException.h"
 
 //template<typename T>
@@ -32,40 +35,152 @@
 //}
 
 
+//Source information of an instruction, the instruction itself is kept in
+//DLXJIT::instructions at the same position
 struct DLXJITCodLine
 {
 	uint32_t iaddr;
 	uint32_t icode;
 	std::string label;
-	std::shared_ptr<DLXTextInstruction> textInstruction;
 };
 
-class DLXJIT
+enum DLXJITEngine
+{
+	NATIVE,
+	INTERPRETER,
+	//interpreter first, hot loops native (DLXJIT::setTieringThreshold)
+	TIERED
+};
+
+//instrumentation of native code, see DLXJIT::setExecutionCounting
+enum DLXExecutionCounting
+{
+	COUNT_NOTHING,
+	//first instruction of every basic block, the others run as often
+	COUNT_BLOCKS,
+	COUNT_INSTRUCTIONS
+};
+
+class DLXJIT : public std::enable_shared_from_this<DLXJIT>
 {
 protected:
 	int numberOfDLXRegisters;
 	typedef std::vector<DLXJITCodLine> CodCollection;
 	CodCollection codContent;
+	typedef std::vector<DLXInstruction> InstructionCollection;
+	InstructionCollection instructions;
 	typedef std::map<std::string, CodCollection::size_type> LabelDictionary;
 	LabelDictionary labelDictionary;
+	//branches parsed from assembly text, resolved by label once all lines are read
+	typedef std::map<InstructionCollection::size_type, std::string> BranchLabels;
 
         DLXJIT::CodCollection::size_type getPositionForLabel(const std::string& label);
-	virtual void saveWordInMemory(std::size_t address, uint32_t data) = 0;
-	virtual void saveHalfInMemory(std::size_t address, uint16_t data) = 0;
-	virtual void saveByteInMemory(std::size_t address, uint8_t data) = 0;
-
-	virtual uint32_t loadWordFromMemory(std::size_t address) = 0;
-	virtual uint16_t loadHalfFromMemory(std::size_t address) = 0;
-	virtual uint8_t loadByteFromMemory(std::size_t address) = 0;
+	DLXJIT::CodCollection::size_type getPositionForAddress(uint32_t iaddr);
+	void addCodLine(uint32_t iaddr, uint32_t icode, std::string&& label, const DLXInstruction& instruction);
+	void resolveBranchTargets(const BranchLabels& branchLabels);
+	std::string instructionToString(InstructionCollection::size_type position);
+	//loaded data and registers, execute() runs the program on it
+	DLXExecutionContext context;
+	unsigned loopUnrollFactor;
+	bool finalRegistersKept;
+	//native code is cached here, empty when caching is off
+	std::string codeCacheDirectory;
+	//position in instructions every optimized instruction was copied from
+	typedef std::vector<InstructionCollection::size_type> SourcePositions;
+	//instructions after all IR passes, their count and positions may differ from instructions
+	void optimizeInstructions(InstructionCollection& optimized, SourcePositions& sourcePositions);
+	//registers whose final values the compiled program has to leave in the context
+	uint32_t getRegistersLiveOnExit() const;
+	//highest data address the program may access plus one, 0 when it can not be bounded;
+	//analysed once per loaded program
+	std::size_t getDataMemoryFootprint() const;
+	//footprint known from elsewhere, e.g. a code cache entry
+	void setDataMemoryFootprint(std::size_t footprint);
+	//engine specific code generation; execution starts at entryPosition, optimizeInstructions
+	//takes care of it
+	virtual std::shared_ptr<const DLXCompiledProgram> compile() = 0;
+	std::shared_ptr<const DLXCompiledProgram> compiledProgram;
+	InstructionCollection::size_type entryPosition;
+	unsigned tieringThreshold;
+	bool lazyCompilation;
+	DLXExecutionCounting executionCounting;
+	//result of getDataMemoryFootprint, valid when dataMemoryFootprintKnown
+	mutable std::size_t dataMemoryFootprint;
+	mutable bool dataMemoryFootprintKnown;
+	//positions in instructions whose executions the generated code counts
+	std::vector<bool> getCountedPositions() const;
+	//position 0, branch targets and positions after branches
+	std::vector<bool> getBlockStarts() const;
+	//symbol of the code generated for a block, with its label and .cod address
+	std::string getCodeName(InstructionCollection::size_type position) const;
+	//names the code of every block in DLXPerfMap when it is open; offsets holds the start
+	//of the code of every optimized instruction, maybe followed by the start of the exit
+	void addToPerfMap(const uint8_t* code, std::size_t size, const std::vector<std::size_t>& offsets,
+		const SourcePositions& sourcePositions) const;
+	//execution counts of compiled programs, one per loaded instruction when counting
+	std::size_t getNumberOfCounters() const { return executionCounting == COUNT_NOTHING ? 0 : instructions.size(); }
+	//native code of a tiered program, entered at the header of a hot loop and generated
+	//lazily where the backend can, so code the interpreter already left behind is not compiled
+	std::shared_ptr<const DLXCompiledProgram> compileFrom(InstructionCollection::size_type position);
+	friend class DLXTieredProgram;
+	//the program and the settings, the context only keeps the data byte order
+	DLXJIT(const DLXJIT& other);
 public:
 	DLXJIT();
 	virtual void loadCode(std::istream& codStream);
+	//raw image of big endian DLX machine words, first one at address 0
+	virtual void loadBinaryCode(std::istream& codeStream);
 	virtual void loadData(std::istream& datStream);
 	virtual void saveData(std::ostream& datStream);
-	virtual std::size_t getDataMemorySize() = 0;
-	virtual void execute() = 0;
+	//.dat contents read into or written from any data memory
+	static void loadData(std::istream& datStream, DLXDataMemory& memory);
+	static void saveData(std::ostream& datStream, DLXDataMemory& memory);
+	//.dat file or memory image (DLXMemoryImage), an image is recognized by its
+	//contents when loading and by its name extension when saving
+	static void loadDataFile(const std::string& fileName, DLXDataMemory& memory);
+	static void saveDataFile(const std::string& fileName, DLXDataMemory& memory);
+	virtual std::size_t getDataMemorySize();
+	//has to be called before the program is compiled or executed
+	virtual void setDataByteOrder(DLXDataByteOrder order);
+	//innermost counted loops are unrolled by this factor, 1 disables unrolling;
+	//has to be called before the program is compiled or executed
+	virtual void setLoopUnrollFactor(unsigned factor);
+	//native engines keep generated code in this directory and reuse it in later runs,
+	//empty (the default) disables the cache; has to be called before the program is compiled
+	virtual void setCodeCacheDirectory(const std::string& directory);
+	//final values of all registers are written back to the execution context,
+	//by default only data memory is; has to be called before the program is compiled
+	virtual void setFinalRegistersKept(bool kept);
+	//programs start in the interpreter, a loop is compiled once it has run this many
+	//iterations and the rest of the program runs as native code; 0 compiles everything
+	//up front. The instance has to be owned by a shared_ptr (see createInstance), it
+	//compiles for the program as long as it exists.
+	virtual void setTieringThreshold(unsigned iterations);
+	static const unsigned defaultTieringThreshold = 1000;
+	//native code is generated per basic block when the block is reached for the
+	//first time (DLXLazyNativeProgram) instead of for the whole program up front;
+	//the optimization passes and register allocation still cover the whole program
+	//before the first block. The code cache is not used. x64 only, has to be called
+	//before the program is compiled
+	virtual void setLazyCompilation(bool lazy);
+	//native code adds the executions of instructions or basic blocks to the execution
+	//counts of the context (see printHotspots). Off by default, the code is then the same
+	//as without counting. Counted code is compiled up front and without optimization
+	//passes, so that every loaded instruction keeps code of its own. Has to be called
+	//before the program is compiled
+	virtual void setExecutionCounting(DLXExecutionCounting counting);
+	//the most executed instructions of the execution counts in the context, with their
+	//.cod address, label and text; all executed ones when lines is 0
+	virtual void printHotspots(std::ostream& out, std::size_t lines);
+	//compiles the program on the first call, not thread safe; the program itself
+	//may be executed by many threads at once, each with its own context
+	std::shared_ptr<const DLXCompiledProgram> getCompiledProgram();
+	//runs the compiled program on the loaded data
+	virtual void execute();
+	//context with the loaded data and the registers of the last execute()
+	DLXExecutionContext& getExecutionContext() { return context; }
 	virtual ~DLXJIT();
 
-	static std::shared_ptr<DLXJIT> createInstance();
+	static std::shared_ptr<DLXJIT> createInstance(DLXJITEngine engine = NATIVE);
 };
 
@@ -9,17 +9,30 @@
 #include "DLXJITArm7.h"
 #include <endian.h>
 #include <cstring>
-#include <sys/mman.h>
+#include <cstdlib>
 #include <initializer_list>
 #include <iostream>
 #include "utils.h"
+#include "DLXCodeCache.h"
+#include "DLXLivenessAnalysis.h"
+#include "DLXRegisterAllocator.h"
 
 using namespace std;
 
 #define DATA_POINTER_REGISTER R0
+//second argument, pointer to the registers of the execution context
+#define REGISTERS_POINTER_REGISTER R1
+//third argument, kept on the stack when executions are counted
+#define EXECUTION_COUNTS_POINTER_REGISTER R2
 #define FIRST_ARGUMENT_CACHE_REGISTER R8
 #define SECOND_ARGUMENT_CACHE_REGISTER R9
 #define RESULT_CACHE_REGISTER R10
+//holds immediates that do not fit in an instruction, never used together with the second argument
+#define IMMEDIATE_SCRATCH_REGISTER R9
+
+//host registers handed out to DLX registers by DLXRegisterAllocator, the rest live on the stack
+static const Register allocatableRegisters[] = { R1, R2, R3, R4, R5, R6, R7, R11, R12, LR };
+static const int numberOfAllocatableRegisters = sizeof(allocatableRegisters) / sizeof(allocatableRegisters[0]);
 
 template<typename T>
 inline void serialize(std::vector<char>& code, const T& serializable)
@@ -40,17 +53,34 @@ inline uint16_t registersList(initializer_list<Register> list)
     return ret;
 }
 
-inline int getDLXRegisterNumber(const std::string& name)
+//ARM immediate operand is an 8 bit value rotated right by an even amount
+inline bool encodeModifiedImmediate(uint32_t value, uint16_t& encoded)
 {
-	if (!isRegisterName(name))
-		throw DLXJITException(("Invalid register name: " + name).c_str());
+    for (uint32_t rotation = 0; rotation < 16; rotation++)
+    {
+        uint32_t rotated = rotation == 0 ? value : (value << (2 * rotation)) | (value >> (32 - 2 * rotation));
+        if (rotated <= 0xFF)
+        {
+            encoded = rotation << 8 | rotated;
+            return true;
+        }
+    }
+    return false;
+}
 
-	return stoi(name.substr(1));
+inline bool fitsInLoadStoreOffset(int32_t offset)
+{
+    return offset > -4096 && offset < 4096;
 }
 
 inline int getDLXRegisterOffsetOnStack(int regNumber)
 {
-	return (regNumber - 8) * 4;
+	return regNumber * 4;
+}
+
+inline int getDLXRegisterOffsetInContext(int regNumber)
+{
+	return regNumber * 4;
 }
 
 inline void setFlagsForLoadStoreMode(LoadStoreMode mode, bool &P, bool &W)
@@ -74,50 +104,10 @@ inline void setFlagsForLoadStoreMode(LoadStoreMode mode, bool &P, bool &W)
 
 
 DLXJITArm7::DLXJITArm7() 
-    : program(nullptr)
+    : byteSwapData(true), predicatedInstructionsLeft(0), predicateCondition(AL)
 {
 }
 
-uint8_t DLXJITArm7::loadByteFromMemory(std::size_t address) {
-    if (address + 1 > data.size())
-            data.resize(address + 1);
-    return *((uint8_t*)&data[address]);
-}
-
-void DLXJITArm7::saveByteInMemory(std::size_t address, uint8_t value) {
-    if (address + 1 > data.size())
-		data.resize(address + 1);
-    *((uint8_t*)&data[address]) = value;
-}
-
-uint16_t DLXJITArm7::loadHalfFromMemory(std::size_t address) {
-    if (address + 2 > data.size())
-            data.resize(address + 2);
-    return be16toh(*((uint16_t*)&data[address]));
-}
-
-void DLXJITArm7::saveHalfInMemory(std::size_t address, uint16_t value) {
-    if (address + 2 > data.size())
-		data.resize(address + 2);
-    *((uint16_t*)&data[address]) = htobe16(value);
-}
-
-uint32_t DLXJITArm7::loadWordFromMemory(std::size_t address) {
-    if (address + 4 > data.size())
-            data.resize(address + 4);
-    return be32toh(*((uint32_t*)&data[address]));
-}
-
-void DLXJITArm7::saveWordInMemory(std::size_t address, uint32_t value) {
-    if (address + 4 > data.size())
-		data.resize(address + 4);
-    *((uint32_t*)&data[address]) = htobe32(value);
-}
-
-std::size_t DLXJITArm7::getDataMemorySize() {
-    return data.size();
-}
-
 void DLXJITArm7::writeNop(Condition cond)
 {
     MSRAndHintInstruction instr;
@@ -154,44 +144,73 @@ void DLXJITArm7::writeMov(Condition cond, bool updateFlags, Register dest, Regis
     serialize(rawCode,instr);
 }
 
-void DLXJITArm7::writeMov(Condition cond, bool updateFlags, Register dest, int16_t imm)
+void DLXJITArm7::writeMov(Condition cond, bool updateFlags, Register dest, int32_t imm)
 {
-    DataProcessingImmediateInstruction instr;
-    instr.cond = cond;
-    instr.b27 = false;
-    instr.b26 = false;
-    instr.b25 = true;
-
-    if (imm <= 0xFFF)
+    uint16_t encoded;
+    if (encodeModifiedImmediate(imm, encoded))
     {
-        instr.op = 0xd << 1 | (updateFlags ? 1 : 0);
-        instr.Rn = 0;
+        writeDataProcessingImmediate(cond, 0xd, updateFlags, dest, R0, encoded);
+    }
+    else if (encodeModifiedImmediate(~imm, encoded))
+    {
+        //MVN
+        writeDataProcessingImmediate(cond, 0xf, updateFlags, dest, R0, encoded);
     }
     else
     {
         if (updateFlags)
             cout << "Warning: update flags is ignored because of 16 bit imm" << endl;
+        //MOVW and MOVT if the upper half is needed
+        DataProcessingImmediateInstruction instr;
+        instr.cond = cond;
+        instr.b27 = false;
+        instr.b26 = false;
+        instr.b25 = true;
         instr.op = 0x10;
         instr.Rn = (imm & 0xF000) >> 12;
-    }
-    instr.details = dest << 12 | (imm & 0xFFF);
+        instr.details = dest << 12 | (imm & 0xFFF);
+        serialize(rawCode, instr);
 
-    serialize(rawCode, instr);
+        uint16_t upper = (uint32_t)imm >> 16;
+        if (upper != 0)
+        {
+            instr.op = 0x14;
+            instr.Rn = (upper & 0xF000) >> 12;
+            instr.details = dest << 12 | (upper & 0xFFF);
+            serialize(rawCode, instr);
+        }
+    }
 }
 
-
-
-void DLXJITArm7::writeAdd(Condition cond, bool updateFlags, Register dest, Register src1, int16_t imm) {
+void DLXJITArm7::writeDataProcessingImmediate(Condition cond, uint8_t opcode, bool updateFlags, Register dest, Register src1, uint16_t encodedImm)
+{
     DataProcessingImmediateInstruction instr;
     instr.cond = cond;
     instr.b27 = false;
     instr.b26 = false;
     instr.b25 = true;
-    instr.op = 0x4 << 1 | (updateFlags? 1 : 0);
+    instr.op = opcode << 1 | (updateFlags ? 1 : 0);
     instr.Rn = src1;
-    instr.details = dest << 12 | (imm & 0xFFF);
-    
-    serialize(rawCode,instr);
+    instr.details = dest << 12 | encodedImm;
+
+    serialize(rawCode, instr);
+}
+
+void DLXJITArm7::writeAdd(Condition cond, bool updateFlags, Register dest, Register src1, int32_t imm) {
+    uint16_t encoded;
+    if (encodeModifiedImmediate(imm, encoded))
+    {
+        writeDataProcessingImmediate(cond, 0x4, updateFlags, dest, src1, encoded);
+    }
+    else if (encodeModifiedImmediate(-imm, encoded))
+    {
+        writeDataProcessingImmediate(cond, 0x2, updateFlags, dest, src1, encoded);
+    }
+    else
+    {
+        writeMov(cond, false, IMMEDIATE_SCRATCH_REGISTER, imm);
+        writeAdd(cond, updateFlags, dest, src1, IMMEDIATE_SCRATCH_REGISTER);
+    }
 }
 
 void DLXJITArm7::writeAdd(Condition cond, bool updateFlags, Register dest, Register src1, Register src2) {
@@ -210,17 +229,56 @@ void DLXJITArm7::writeAdd(Condition cond, bool updateFlags, Register dest, Regis
     serialize(rawCode, instr);
 }
 
-void DLXJITArm7::writeSub(Condition cond, bool updateFlags, Register dest, Register src1, int16_t imm) {
-    DataProcessingImmediateInstruction instr;
-    instr.cond = cond;
-    instr.b27 = false;
-    instr.b26 = false;
-    instr.b25 = true;
-    instr.op = 0x2 << 1 | (updateFlags? 1 : 0);
-    instr.Rn = src1;
-    instr.details = dest << 12 | (imm & 0xFFF);
-    
-    serialize(rawCode,instr);
+void DLXJITArm7::writeSub(Condition cond, bool updateFlags, Register dest, Register src1, int32_t imm) {
+    uint16_t encoded;
+    if (encodeModifiedImmediate(imm, encoded))
+    {
+        writeDataProcessingImmediate(cond, 0x2, updateFlags, dest, src1, encoded);
+    }
+    else if (encodeModifiedImmediate(-imm, encoded))
+    {
+        writeDataProcessingImmediate(cond, 0x4, updateFlags, dest, src1, encoded);
+    }
+    else
+    {
+        writeMov(cond, false, IMMEDIATE_SCRATCH_REGISTER, imm);
+        writeSub(cond, updateFlags, dest, src1, IMMEDIATE_SCRATCH_REGISTER);
+    }
+}
+
+void DLXJITArm7::writeRsb(Condition cond, bool updateFlags, Register dest, Register src1, int32_t imm) {
+    uint16_t encoded;
+    if (encodeModifiedImmediate(imm, encoded))
+    {
+        writeDataProcessingImmediate(cond, 0x3, updateFlags, dest, src1, encoded);
+    }
+    else
+    {
+        writeMov(cond, false, IMMEDIATE_SCRATCH_REGISTER, imm);
+        writeSub(cond, updateFlags, dest, IMMEDIATE_SCRATCH_REGISTER, src1);
+    }
+}
+
+void DLXJITArm7::writeAdc(Condition cond, Register dest, Register src1, uint8_t imm) {
+    writeDataProcessingImmediate(cond, 0x5, false, dest, src1, imm);
+}
+
+void DLXJITArm7::writeCmp(Condition cond, Register src1, int32_t imm) {
+    uint16_t encoded;
+    if (encodeModifiedImmediate(imm, encoded))
+    {
+        writeDataProcessingImmediate(cond, 0xa, true, R0, src1, encoded);
+    }
+    else if (encodeModifiedImmediate(-imm, encoded))
+    {
+        //CMN
+        writeDataProcessingImmediate(cond, 0xb, true, R0, src1, encoded);
+    }
+    else
+    {
+        writeMov(cond, false, IMMEDIATE_SCRATCH_REGISTER, imm);
+        writeSub(cond, true, IMMEDIATE_SCRATCH_REGISTER, src1, IMMEDIATE_SCRATCH_REGISTER);
+    }
 }
 
 void DLXJITArm7::writeSub(Condition cond, bool updateFlags, Register dest, Register src1, Register src2) {
@@ -295,6 +353,40 @@ void DLXJITArm7::writeRev(Condition cond, Register dest, Register src)
     serialize(rawCode, instr);
 }
 
+void DLXJITArm7::writeAsr(Condition cond, Register dest, Register src, uint8_t shift)
+{
+    DataProcessingRegisterInstruction instr;
+    instr.cond = cond;
+    instr.b27 = false;
+    instr.b26 = false;
+    instr.b25 = false;
+    instr.op = 0xd << 1;
+    instr.details1 = dest;
+    instr.imm5 = shift;
+    instr.op2 = 0x2;
+    instr.b4 = false;
+    instr.details2 = src;
+
+    serialize(rawCode, instr);
+}
+
+void DLXJITArm7::writeAddOffset(Register dest, int32_t offset)
+{
+    uint32_t magnitude = offset < 0 ? -(uint32_t)offset : offset;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t chunk = magnitude & (0xFFu << shift);
+        uint16_t encoded;
+        if (chunk != 0 && encodeModifiedImmediate(chunk, encoded))
+            writeDataProcessingImmediate(AL, offset < 0 ? 0x2 : 0x4, false, dest, dest, encoded);
+    }
+}
+
+void DLXJITArm7::writeNeonInstruction(uint32_t encoding)
+{
+    serialize(rawCode, encoding);
+}
+
 void DLXJITArm7::writeLDR(Condition cond, LoadStoreMode mode,  bool add, Register dst, Register base, uint16_t offset) {
     LoadStoreInstruction instr;
     bool U = add;
@@ -399,10 +491,18 @@ void DLXJITArm7::writeB(Condition cond, int32_t offset) {
 }
 
 
+bool DLXJITArm7::isDLXRegisterMapped(int no) {
+    return no > 0 && dlxRegisterAllocation[no] != DLXRegisterAllocator::SPILLED;
+}
+
+Register DLXJITArm7::getMappedRegister(int no) {
+    return allocatableRegisters[dlxRegisterAllocation[no]];
+}
+
 Register DLXJITArm7::loadDLXRegister(int no,int argumentNumber) {
-    if(no > 0 && no < 8)
+    if(isDLXRegisterMapped(no))
     {
-        return (Register)no;
+        return getMappedRegister(no);
     }
     else
     {
@@ -424,16 +524,16 @@ Register DLXJITArm7::loadDLXRegister(int no,int argumentNumber) {
 }
 
 Register DLXJITArm7::getRegisterForTargetDLXRegister(int no) {
-    if(no > 0 && no < 8)
+    if(isDLXRegisterMapped(no))
     {
-        return (Register)no;
+        return getMappedRegister(no);
     }
     
     return RESULT_CACHE_REGISTER;
 }
 
 void DLXJITArm7::storeTargetDLXRegister(int no) {
-    if(no > 0 && no < 8)
+    if(isDLXRegisterMapped(no))
     {
         //NOP
         return;
@@ -442,255 +542,473 @@ void DLXJITArm7::storeTargetDLXRegister(int no) {
     writeSTR(AL,OFFSET,true,RESULT_CACHE_REGISTER,SP,getDLXRegisterOffsetOnStack(no));
 }
 
-int32_t DLXJITArm7::calcBranchOffset(CodCollection::size_type targetDlx, RawCodeContainer::size_type branchInstructionPosition ) {
+int32_t DLXJITArm7::calcBranchOffset(InstructionCollection::size_type targetDlx, RawCodeContainer::size_type branchInstructionPosition ) {
     return dlxOffsetsInRawCode[targetDlx] - (branchInstructionPosition+8);
 }
 
+void DLXJITArm7::writeBranch(Condition cond, InstructionCollection::size_type targetDlx) {
+    int32_t offset = 0;
+    if(dlxOffsetsInRawCode.size() > targetDlx)
+        offset = calcBranchOffset(targetDlx,rawCode.size());
+    else
+        jumpOffsetsToRepair.push_back({targetDlx, rawCode.size()});
+
+    writeB(cond,offset);
+}
 
-bool DLXJITArm7::compileDLXInstruction(const DLXJITCodLine& line, const DLXJITCodLine& nextline, bool skip_this) { //zwraca true gdy należy pominąć kolejną instrukcję
-    bool skip_next;
-    skip_next = false;
-    if (skip_this)
+void DLXJITArm7::writeConditionalBranch(Condition cond, const DLXInstruction& branch) {
+    if (branch.predicated == 0)
     {
-        //do nothing
+        writeBranch(cond, branch.target);
+        return;
     }
-    else if (line.textInstruction->opcode() == "ADD")
+    //conditions come in pairs, the lowest bit negates them
+    predicateCondition = (Condition)(cond ^ 1);
+    predicatedInstructionsLeft = branch.predicated;
+}
+
+
+int32_t DLXJITArm7::writeDataAddress(int indexRegisterNo, int32_t offset) {
+    //address is left in the first cache register, the offset that still has to be added is returned
+    Register indexRegister = loadDLXRegister(indexRegisterNo, 0);
+    writeAdd(AL, false, FIRST_ARGUMENT_CACHE_REGISTER, indexRegister, DATA_POINTER_REGISTER);
+    if (fitsInLoadStoreOffset(offset))
+        return offset;
+    writeAdd(AL, false, FIRST_ARGUMENT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, offset);
+    return 0;
+}
+
+void DLXJITArm7::compileDLXInstruction(const DLXInstruction& instr) {
+    switch (instr.opcode)
     {
-        shared_ptr<DLXRTypeTextInstruction> instr = dynamic_pointer_cast<DLXRTypeTextInstruction>(line.textInstruction);
-        int destination = getDLXRegisterNumber(instr->reg(2));
-        if(destination > 0)
+    case OP_ADD:
+        if(instr.rd > 0)
         {
-            Register src1 = loadDLXRegister(getDLXRegisterNumber(instr->reg(0)),0);
-            Register src2 = loadDLXRegister(getDLXRegisterNumber(instr->reg(1)),1);
-            Register dst = getRegisterForTargetDLXRegister(destination);
+            Register src1 = loadDLXRegister(instr.rs1,0);
+            Register src2 = loadDLXRegister(instr.rs2,1);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
             writeAdd(AL,false,dst,src1,src2);
-            storeTargetDLXRegister(destination);
+            storeTargetDLXRegister(instr.rd);
         }
-    }
-    else if (line.textInstruction->opcode() == "ADDI")
-    {
-        shared_ptr<DLXITypeTextInstruction> instr = dynamic_pointer_cast<DLXITypeTextInstruction>(line.textInstruction);
-        int destination = getDLXRegisterNumber(instr->reg(1));
-        if (destination > 0)
+        break;
+    case OP_ADDI:
+        if (instr.rd > 0)
         {
-            Register src1 = loadDLXRegister(getDLXRegisterNumber(instr->reg(0)), 0);
-            Register dst = getRegisterForTargetDLXRegister(destination);
-            writeAdd(AL,false,dst,src1,instr->immediate());
-            storeTargetDLXRegister(destination);
+            Register src1 = loadDLXRegister(instr.rs1, 0);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            writeAdd(AL,false,dst,src1,instr.imm);
+            storeTargetDLXRegister(instr.rd);
         }
-    }
-    else if (line.textInstruction->opcode() == "SUBI")
-    {
-        shared_ptr<DLXITypeTextInstruction> instr = dynamic_pointer_cast<DLXITypeTextInstruction>(line.textInstruction);
-        int destination = getDLXRegisterNumber(instr->reg(1));
-        if (destination > 0)
+        break;
+    case OP_SUBI:
+        if (instr.rd > 0)
         {
-            Register src1 = loadDLXRegister(getDLXRegisterNumber(instr->reg(0)), 0);
-            Register dst = getRegisterForTargetDLXRegister(destination);
-            writeSub(AL, false, dst, src1, instr->immediate());
-            storeTargetDLXRegister(destination);
+            Register src1 = loadDLXRegister(instr.rs1, 0);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            writeSub(AL, false, dst, src1, instr.imm);
+            storeTargetDLXRegister(instr.rd);
         }
-    }
-    else if (line.textInstruction->opcode() == "MULADD")
-    {
-        shared_ptr<DLXRTypeTextInstruction> instr = dynamic_pointer_cast<DLXRTypeTextInstruction>(line.textInstruction);
-        int destination = getDLXRegisterNumber(instr->reg(2));
-        if (destination > 0)
+        break;
+    case OP_MULADD:
+        if (instr.rd > 0)
         {
-            Register mul_src1 = loadDLXRegister(getDLXRegisterNumber(instr->reg(0)), 0);
-            Register mul_src2 = loadDLXRegister(getDLXRegisterNumber(instr->reg(1)), 1);
-            //writeMul(AL, false, mul_src1, mul_src1, mul_src2);
-            Register add_src = loadDLXRegister(getDLXRegisterNumber(instr->reg(2)), 2);
-            Register dst = getRegisterForTargetDLXRegister(destination);
-            //writeAdd(AL, false, dst, mul_src1, add_src);
+            Register mul_src1 = loadDLXRegister(instr.rs1, 0);
+            Register mul_src2 = loadDLXRegister(instr.rs2, 1);
+            Register add_src = loadDLXRegister(instr.rd, 2);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
             writeMla(AL, false, dst, mul_src1, mul_src2, add_src);
-            storeTargetDLXRegister(destination);
+            storeTargetDLXRegister(instr.rd);
         }
-    }
-    else if (line.textInstruction->opcode() == "LOOPCHECK")
-    {
-        shared_ptr<DLXITypeTextInstruction> instr = dynamic_pointer_cast<DLXITypeTextInstruction>(line.textInstruction);
-        int destination = getDLXRegisterNumber(instr->reg(1));
-        if (destination > 0) //Zapisywanie do rejsetru R0 jest niedozwolone
+        break;
+    case OP_LOOPCHECK:
+    case OP_LOOPCHECK_BRLE:
+    case OP_LOOPCHECK_BRGE:
+        //result of a fused branch that is never read is computed only for the flags
+        if (instr.rd > 0 || instr.opcode != OP_LOOPCHECK) //Zapisywanie do rejsetru R0 jest niedozwolone
         {
-            Register src = loadDLXRegister(getDLXRegisterNumber(instr->reg(0)), 0);
-            Register dst = getRegisterForTargetDLXRegister(destination);
-            writeMov(AL, false, R9, instr->immediate());
-            writeSub(AL, false, dst, R9, src);
-            storeTargetDLXRegister(destination);
+            Register src = loadDLXRegister(instr.rs1, 0);
+            Register dst = instr.rd > 0 ? getRegisterForTargetDLXRegister(instr.rd) : IMMEDIATE_SCRATCH_REGISTER;
+            bool branch = instr.opcode != OP_LOOPCHECK;
+            writeRsb(AL, branch, dst, src, instr.imm);
+            if (instr.rd > 0)
+                storeTargetDLXRegister(instr.rd);
+            //N and Z describe the result, V of the subtraction is not valid for a comparison with 0
+            if (instr.opcode == OP_LOOPCHECK_BRGE)
+            {
+                writeConditionalBranch(PL, instr);
+            }
+            else if (instr.opcode == OP_LOOPCHECK_BRLE && instr.predicated > 0)
+            {
+                //MI or EQ is not a single condition, GT after a comparison is
+                writeCmp(AL, dst, 0);
+                writeConditionalBranch(LE, instr);
+            }
+            else if (instr.opcode == OP_LOOPCHECK_BRLE)
+            {
+                writeBranch(MI, instr.target);
+                writeBranch(EQ, instr.target);
+            }
         }
         //Instrukcja LOOPCHECK wykonuje odejmuje imm64 od rejestru source (R1), a następnie zapisuje wynik do R3
-
-    }
-    else if (line.textInstruction->opcode() == "LDW" && nextline.textInstruction->opcode() == "STW" &&
-     dynamic_pointer_cast<DLXMTypeTextInstruction>(line.textInstruction)->dataRegister() == 
-        dynamic_pointer_cast<DLXMTypeTextInstruction>(nextline.textInstruction)->dataRegister())
-    {
-        shared_ptr<DLXMTypeTextInstruction> ldw_instr = dynamic_pointer_cast<DLXMTypeTextInstruction>(line.textInstruction);
-        shared_ptr<DLXMTypeTextInstruction> stw_instr = dynamic_pointer_cast<DLXMTypeTextInstruction>(nextline.textInstruction);
-        int destination = getDLXRegisterNumber(ldw_instr->dataRegister());
-        if (destination > 0)
+        break;
+    case OP_LI:
+        if (instr.rd > 0)
         {
-            Register ldw_indexRegister = loadDLXRegister(getDLXRegisterNumber(ldw_instr->indexRegister()), 0);
-            Register dataMemoryOffsetRegister = FIRST_ARGUMENT_CACHE_REGISTER;
-            writeAdd(AL, false, dataMemoryOffsetRegister, ldw_indexRegister, DATA_POINTER_REGISTER);
-            Register dst = getRegisterForTargetDLXRegister(destination);
-            writeLDR(AL, OFFSET, true, dst, dataMemoryOffsetRegister, ldw_instr->baseAddress());
-
-            Register stw_indexRegister = loadDLXRegister(getDLXRegisterNumber(stw_instr->indexRegister()), 0);
-            //Register dataMemoryOffsetRegister = FIRST_ARGUMENT_CACHE_REGISTER;
-            writeAdd(AL, false, dataMemoryOffsetRegister, stw_indexRegister, DATA_POINTER_REGISTER);
-            //writeLDR(AL, OFFSET, true, dst, dataMemoryOffsetRegister, instr->baseAddress());
-            writeSTR(AL, OFFSET, true, dst, dataMemoryOffsetRegister, stw_instr->baseAddress());
-            
-            writeRev(AL, dst, dst);
-            storeTargetDLXRegister(destination);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            writeMov(AL, false, dst, instr.imm);
+            storeTargetDLXRegister(instr.rd);
         }
+        break;
+    case OP_MOV:
+        if (instr.rd > 0)
+        {
+            Register src = loadDLXRegister(instr.rs1, 0);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            if (dst != src)
+                writeMov(AL, false, dst, src);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_COPYW:
+        {
+            //word is copied as it is, so only the register value needs to be swapped
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            int32_t offset = writeDataAddress(instr.rs1, instr.imm);
+            writeLDR(AL, OFFSET, offset >= 0, dst, FIRST_ARGUMENT_CACHE_REGISTER, abs(offset));
 
-        skip_next = true;
+            offset = writeDataAddress(instr.rs2, instr.imm2);
+            writeSTR(AL, OFFSET, offset >= 0, dst, FIRST_ARGUMENT_CACHE_REGISTER, abs(offset));
+
+            if (byteSwapData)
+                writeRev(AL, dst, dst);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_LDW:
+        if(instr.rd > 0)
+        {
+            int32_t offset = writeDataAddress(instr.rs1, instr.imm);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            writeLDR(AL, OFFSET, offset >= 0, dst, FIRST_ARGUMENT_CACHE_REGISTER, abs(offset));
+            if (byteSwapData)
+                writeRev(AL,dst,dst);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_STW:
+        {
+            int32_t offset = writeDataAddress(instr.rs1, instr.imm);
+            Register src = loadDLXRegister(instr.rs2, 1);
+            if (byteSwapData)
+                writeRev(AL, src, src);
+            writeSTR(AL, OFFSET, offset >= 0, src, FIRST_ARGUMENT_CACHE_REGISTER, abs(offset));
+            //value loaded to the cache register does not need to be restored
+            if (byteSwapData && src != SECOND_ARGUMENT_CACHE_REGISTER)
+                writeRev(AL, src, src);
+        }
+        break;
+    case OP_BRLE:
+    case OP_BRGE:
+        //R0 compares equal to 0, so the branch is always taken
+        if (instr.rs1 == 0)
+        {
+            writeBranch(AL, instr.target);
+            break;
+        }
+        {
+            Register reg = loadDLXRegister(instr.rs1,0);
+            writeCmp(AL, reg, 0);
+            writeConditionalBranch(instr.opcode == OP_BRLE ? LE : GE, instr);
+        }
+        break;
+    case OP_DOTW:
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+        writeDotProduct(instr);
+#endif
+        //without NEON the loop runs alone
+        break;
+    case OP_NOP:
+        //NOP ;)
+        break;
+    default:
+        {
+            //Poniższe linie można zakomentować w celu uruchomiania programu bez wszystkich rozkazów
+            string message = string("Unsupported DLX opcode: ") + getOpcodeName(instr.opcode);
+            throw DLXJITException(message.c_str());
+        }
     }
+}
 
-    else if (line.textInstruction->opcode() == "LDW")
+void DLXJITArm7::compilePredicatedInstruction(const DLXInstruction& instr, Condition cond) {
+    if (instr.opcode == OP_NOP || instr.rd == 0)
+        return;
+    //operands are loaded unconditionally, none of the instructions changes flags
+    Register dst = getRegisterForTargetDLXRegister(instr.rd);
+    switch (instr.opcode)
     {
-        shared_ptr<DLXMTypeTextInstruction> instr = dynamic_pointer_cast<DLXMTypeTextInstruction>(line.textInstruction);
-        int destination = getDLXRegisterNumber(instr->dataRegister());
-        if(destination > 0)
+    case OP_ADD:
         {
-            Register indexRegister = loadDLXRegister(getDLXRegisterNumber(instr->indexRegister()),0);
-            Register dataMemoryOffsetRegister = FIRST_ARGUMENT_CACHE_REGISTER;
-            writeAdd(AL,false,dataMemoryOffsetRegister,indexRegister,DATA_POINTER_REGISTER);
-            Register dst = getRegisterForTargetDLXRegister(destination);
-            writeLDR(AL,OFFSET,true,dst,dataMemoryOffsetRegister,instr->baseAddress());
-            writeRev(AL,dst,dst);
-            storeTargetDLXRegister(destination);
+            Register src1 = loadDLXRegister(instr.rs1, 0);
+            Register src2 = loadDLXRegister(instr.rs2, 1);
+            writeAdd(cond, false, dst, src1, src2);
+        }
+        break;
+    case OP_ADDI:
+        writeAdd(cond, false, dst, loadDLXRegister(instr.rs1, 0), instr.imm);
+        break;
+    case OP_SUBI:
+        writeSub(cond, false, dst, loadDLXRegister(instr.rs1, 0), instr.imm);
+        break;
+    case OP_LI:
+        writeMov(cond, false, dst, instr.imm);
+        break;
+    case OP_MOV:
+        {
+            Register src = loadDLXRegister(instr.rs1, 0);
+            if (dst != src)
+                writeMov(cond, false, dst, src);
+        }
+        break;
+    default:
+        {
+            string message = string("DLX opcode can not be predicated: ") + getOpcodeName(instr.opcode);
+            throw DLXJITException(message.c_str());
         }
     }
-    else if (line.textInstruction->opcode() == "STW")
-    {
-        shared_ptr<DLXMTypeTextInstruction> instr = dynamic_pointer_cast<DLXMTypeTextInstruction>(line.textInstruction);
-        int source = getDLXRegisterNumber(instr->dataRegister());
-        Register indexRegister = loadDLXRegister(getDLXRegisterNumber(instr->indexRegister()), 0);
-        Register dataMemoryOffsetRegister = FIRST_ARGUMENT_CACHE_REGISTER;
-        writeAdd(AL, false, dataMemoryOffsetRegister, indexRegister, DATA_POINTER_REGISTER);
-        Register src = getRegisterForTargetDLXRegister(source);
-        writeRev(AL, src, src);
-        //writeLDR(AL, OFFSET, true, dst, dataMemoryOffsetRegister, instr->baseAddress());
-        writeSTR(AL, OFFSET, true, src, dataMemoryOffsetRegister, instr->baseAddress());
-        writeRev(AL, src, src);
-        //storeTargetDLXRegister(source);
-    }
-    else if (line.textInstruction->opcode() == "BRLE")
-    {
-        shared_ptr<DLXJTypeTextInstruction> instr = dynamic_pointer_cast<DLXJTypeTextInstruction>(line.textInstruction);
-        int branch = getDLXRegisterNumber(instr->branchRegister());
-        Register reg = loadDLXRegister(branch,0);
-        writeMov(AL,true,FIRST_ARGUMENT_CACHE_REGISTER,reg);
-        int32_t offset = 0;
-        
-        const string& label = instr->label();
-        
-        auto targetDlx =  getPositionForLabel(label);
-        if(dlxOffsetsInRawCode.size() > targetDlx)
-            offset = calcBranchOffset(targetDlx,rawCode.size());
-        else
-            jumpOffsetsToRepair.push_back({instr, rawCode.size()});
-            
-        writeB(LE,offset); 
+    if (!isDLXRegisterMapped(instr.rd))
+        writeSTR(cond, OFFSET, true, RESULT_CACHE_REGISTER, SP, getDLXRegisterOffsetOnStack(instr.rd));
+}
+
+void DLXJITArm7::writeDotProduct(const DLXInstruction& instr) {
+    //R10 = number of 4 word vectors the loop runs before its exit or a wrap
+    Register pointerA = loadDLXRegister(instr.rs1, 0);
+    writeRsb(AL, false, FIRST_ARGUMENT_CACHE_REGISTER, pointerA, lowHalf(instr.imm2));
+    Register pointerB = loadDLXRegister(instr.rs2, 2);
+    writeRsb(AL, false, RESULT_CACHE_REGISTER, pointerB, highHalf(instr.imm2));
+    writeSub(AL, true, SECOND_ARGUMENT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, RESULT_CACHE_REGISTER);
+    writeMov(GT, false, FIRST_ARGUMENT_CACHE_REGISTER, RESULT_CACHE_REGISTER);
+    writeAsr(AL, RESULT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, 4);
+    writeCmp(AL, RESULT_CACHE_REGISTER, 0);
+    auto skipPosition = rawCode.size();
+    writeB(LE, 0);
+
+    //R8 and R9 point to the words in host memory
+    pointerA = loadDLXRegister(instr.rs1, 0);
+    writeAdd(AL, false, FIRST_ARGUMENT_CACHE_REGISTER, DATA_POINTER_REGISTER, pointerA);
+    writeAddOffset(FIRST_ARGUMENT_CACHE_REGISTER, lowHalf(instr.imm));
+    pointerB = loadDLXRegister(instr.rs2, 1);
+    writeAdd(AL, false, SECOND_ARGUMENT_CACHE_REGISTER, DATA_POINTER_REGISTER, pointerB);
+    writeAddOffset(SECOND_ARGUMENT_CACHE_REGISTER, highHalf(instr.imm));
+    writeNeonInstruction(0xF2800050); //vmov.i32 q0, #0
+
+    auto loopPosition = rawCode.size();
+    writeNeonInstruction(0xF4200A8D | FIRST_ARGUMENT_CACHE_REGISTER << 16 | 2 << 12); //vld1.32 {d2, d3}, [R8]!
+    writeNeonInstruction(0xF4200A8D | SECOND_ARGUMENT_CACHE_REGISTER << 16 | 4 << 12); //vld1.32 {d4, d5}, [R9]!
+    if (byteSwapData)
+    {
+        writeNeonInstruction(0xF3B020C2); //vrev32.8 q1, q1
+        writeNeonInstruction(0xF3B040C4); //vrev32.8 q2, q2
     }
-    else if (line.textInstruction->opcode() == "BRGE")
+    writeNeonInstruction(0xF2220944); //vmla.i32 q0, q1, q2
+    writeSub(AL, true, RESULT_CACHE_REGISTER, RESULT_CACHE_REGISTER, 1);
+    writeB(NE, loopPosition - (rawCode.size() + 8));
+
+    //pointers are taken back from the addresses
+    writeSub(AL, false, FIRST_ARGUMENT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, DATA_POINTER_REGISTER);
+    writeAddOffset(FIRST_ARGUMENT_CACHE_REGISTER, -lowHalf(instr.imm));
+    Register dst = getRegisterForTargetDLXRegister(instr.rs1);
+    writeMov(AL, false, dst, FIRST_ARGUMENT_CACHE_REGISTER);
+    storeTargetDLXRegister(instr.rs1);
+    if (instr.rs2 != instr.rs1)
     {
-        shared_ptr<DLXJTypeTextInstruction> instr = dynamic_pointer_cast<DLXJTypeTextInstruction>(line.textInstruction);
-        int branch = getDLXRegisterNumber(instr->branchRegister());
-        Register reg = loadDLXRegister(branch, 0);
-        writeMov(AL, true, FIRST_ARGUMENT_CACHE_REGISTER, reg);
-        int32_t offset = 0;
+        writeSub(AL, false, SECOND_ARGUMENT_CACHE_REGISTER, SECOND_ARGUMENT_CACHE_REGISTER, DATA_POINTER_REGISTER);
+        writeAddOffset(SECOND_ARGUMENT_CACHE_REGISTER, -highHalf(instr.imm));
+        dst = getRegisterForTargetDLXRegister(instr.rs2);
+        writeMov(AL, false, dst, SECOND_ARGUMENT_CACHE_REGISTER);
+        storeTargetDLXRegister(instr.rs2);
+    }
 
-        const string& label = instr->label();
+    //horizontal sum of the 4 lanes
+    writeNeonInstruction(0xF2200801); //vadd.i32 d0, d0, d1
+    writeNeonInstruction(0xF2200B10); //vpadd.i32 d0, d0, d0
+    writeNeonInstruction(0xEE100B10 | FIRST_ARGUMENT_CACHE_REGISTER << 12); //vmov.32 R8, d0[0]
+    Register addSrc = loadDLXRegister(instr.rd, 1);
+    dst = getRegisterForTargetDLXRegister(instr.rd);
+    writeAdd(AL, false, dst, addSrc, FIRST_ARGUMENT_CACHE_REGISTER);
+    storeTargetDLXRegister(instr.rd);
 
-        auto targetDlx = getPositionForLabel(label);
-        if (dlxOffsetsInRawCode.size() > targetDlx)
-            offset = calcBranchOffset(targetDlx, rawCode.size());
-        else
-            jumpOffsetsToRepair.push_back({ instr, rawCode.size() });
+    BInstruction& skip = *((BInstruction*)&rawCode[skipPosition]);
+    skip.imm = (int32_t)(rawCode.size() - (skipPosition + 8)) >> 2;
+}
 
-        writeB(GE, offset);
+void DLXJITArm7::writeLoadDLXRegisters(uint32_t registers) {
+    //initial values come from the context, only the ones read before written are needed
+    int pointerHolder = 0;
+    for (int no = 1; no < numberOfDLXRegisters; no++)
+    {
+        if (!(registers & (1u << no)))
+            continue;
+        if (!isDLXRegisterMapped(no))
+        {
+            writeLDR(AL, OFFSET, true, FIRST_ARGUMENT_CACHE_REGISTER, REGISTERS_POINTER_REGISTER, getDLXRegisterOffsetInContext(no));
+            writeSTR(AL, OFFSET, true, FIRST_ARGUMENT_CACHE_REGISTER, SP, getDLXRegisterOffsetOnStack(no));
+        }
+        else if (getMappedRegister(no) == REGISTERS_POINTER_REGISTER)
+            pointerHolder = no;
+        else
+            writeLDR(AL, OFFSET, true, getMappedRegister(no), REGISTERS_POINTER_REGISTER, getDLXRegisterOffsetInContext(no));
     }
-    else if (line.textInstruction->opcode() == "NOP")
+    //the pointer is overwritten last
+    if (pointerHolder != 0)
+        writeLDR(AL, OFFSET, true, REGISTERS_POINTER_REGISTER, REGISTERS_POINTER_REGISTER, getDLXRegisterOffsetInContext(pointerHolder));
+}
+
+void DLXJITArm7::writeStoreDLXRegisters() {
+    writeLDR(AL, OFFSET, true, FIRST_ARGUMENT_CACHE_REGISTER, SP, getRegistersPointerOffsetOnStack());
+    for (int no = 1; no < numberOfDLXRegisters; no++)
     {
-            //NOP ;)
+        Register value = loadDLXRegister(no, 1);
+        writeSTR(AL, OFFSET, true, value, FIRST_ARGUMENT_CACHE_REGISTER, getDLXRegisterOffsetInContext(no));
     }
-    else
+}
+
+int DLXJITArm7::getRegistersPointerOffsetOnStack() {
+    return getDLXRegisterOffsetOnStack(numberOfDLXRegisters);
+}
+
+int DLXJITArm7::getExecutionCountsPointerOffsetOnStack() {
+    return getRegistersPointerOffsetOnStack() + (finalRegistersKept ? 8 : 0);
+}
+
+void DLXJITArm7::writeCountExecution(InstructionCollection::size_type position) {
+    //64 bit count, flags are not live between DLX instructions
+    writeLDR(AL, OFFSET, true, FIRST_ARGUMENT_CACHE_REGISTER, SP, getExecutionCountsPointerOffsetOnStack());
+    int32_t offset = position * sizeof(uint64_t);
+    if (!fitsInLoadStoreOffset(offset + 4))
     {
-        //Poniższe linie można zakomentować w celu uruchomiania programu bez wszystkich rozkazów
-        string message = "Unsupported DLX opcode: " + line.textInstruction->opcode();
-        throw DLXJITException(message.c_str());
+        writeAddOffset(FIRST_ARGUMENT_CACHE_REGISTER, offset);
+        offset = 0;
     }
-    return skip_next;
+    writeLDR(AL, OFFSET, true, RESULT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, offset);
+    writeAdd(AL, true, RESULT_CACHE_REGISTER, RESULT_CACHE_REGISTER, 1);
+    writeSTR(AL, OFFSET, true, RESULT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, offset);
+    writeLDR(AL, OFFSET, true, RESULT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, offset + 4);
+    writeAdc(AL, RESULT_CACHE_REGISTER, RESULT_CACHE_REGISTER, 0);
+    writeSTR(AL, OFFSET, true, RESULT_CACHE_REGISTER, FIRST_ARGUMENT_CACHE_REGISTER, offset + 4);
 }
 
 void DLXJITArm7::repairBranchOffsets() {
     for(auto& toRepair : this->jumpOffsetsToRepair)
     {
-        auto targetDLX = getPositionForLabel(toRepair.dlxInstruction->label());
         BInstruction& binstr = *((BInstruction*)&rawCode[toRepair.branchInstructionOffset]);
-        binstr.imm = calcBranchOffset(targetDLX, toRepair.branchInstructionOffset) >> 2;
+        binstr.imm = calcBranchOffset(toRepair.targetDlx, toRepair.branchInstructionOffset) >> 2;
     }
 }
 
 
 
-void DLXJITArm7::compile() {
+void DLXJITArm7::generateCode() {
     rawCode.clear();
+    rawCode.reserve(instructions.size() * 16);
+    dlxOffsetsInRawCode.clear();
+    //branches of an earlier compile, tiered programs compile once per entry
+    jumpOffsetsToRepair.clear();
     
+    InstructionCollection optimized;
+    optimizeInstructions(optimized, sourcePositions);
+
+    DLXLivenessAnalysis liveness(optimized, getRegistersLiveOnExit());
+    DLXRegisterAllocator allocator(optimized, liveness, numberOfDLXRegisters, numberOfAllocatableRegisters);
+    dlxRegisterAllocation.resize(numberOfDLXRegisters);
+    for (int no = 0; no < numberOfDLXRegisters; no++)
+        dlxRegisterAllocation[no] = allocator.getHostRegister(no);
+
     writePush(AL,registersList({R4,R5,R6,R7,R8,R9,R10,R11,LR}));
-    writeSub(AL,false,SP,SP,(numberOfDLXRegisters - 8)*4);
-    bool skip_next = false;
-    for (int i = 0; i < codContent.size(); i++)
+    //spilled DLX registers, followed by the registers pointer when final values are kept
+    //and the execution counts pointer when they are counted
+    int32_t frameSize = numberOfDLXRegisters * 4 + (finalRegistersKept ? 8 : 0) + (executionCounting != COUNT_NOTHING ? 8 : 0);
+    writeSub(AL,false,SP,SP,frameSize);
+    if (finalRegistersKept)
+        writeSTR(AL, OFFSET, true, REGISTERS_POINTER_REGISTER, SP, getRegistersPointerOffsetOnStack());
+    if (executionCounting != COUNT_NOTHING)
+        writeSTR(AL, OFFSET, true, EXECUTION_COUNTS_POINTER_REGISTER, SP, getExecutionCountsPointerOffsetOnStack());
+    writeLoadDLXRegisters(liveness.getLiveOnEntry());
+    auto countedPositions = getCountedPositions();
+    predicatedInstructionsLeft = 0;
+    for (InstructionCollection::size_type i = 0; i < optimized.size(); i++)
     {
+            const auto& instr = optimized[i];
             dlxOffsetsInRawCode.push_back(rawCode.size());
-            skip_next = compileDLXInstruction(codContent[i], codContent[i+1], skip_next);
-            
+            if (countedPositions[sourcePositions[i]])
+                writeCountExecution(sourcePositions[i]);
+            if (predicatedInstructionsLeft > 0)
+            {
+                compilePredicatedInstruction(instr, predicateCondition);
+                predicatedInstructionsLeft--;
+            }
+            else
+            {
+                compileDLXInstruction(instr);
+            }
     }
-    writeAdd(AL,false,SP,SP,(numberOfDLXRegisters - 8)*4);
+    //branches past the last instruction land on the epilogue
+    dlxOffsetsInRawCode.push_back(rawCode.size());
+    if (finalRegistersKept)
+        writeStoreDLXRegisters();
+    writeAdd(AL,false,SP,SP,frameSize);
     writePop(AL,registersList({R4,R5,R6,R7,R8,R9,R10,R11,PC}));
     repairBranchOffsets();
-    void* mem = mmap(
-                NULL,
-                rawCode.size(),
-                PROT_READ | PROT_WRITE | PROT_EXEC,
-                MAP_ANONYMOUS | MAP_PRIVATE,
-                0,
-                0);
-    memcpy(mem, rawCode.data(), rawCode.size());
-
-    program = (DlxProgram)mem;
+}
+
+shared_ptr<const DLXCompiledProgram> DLXJITArm7::compile() {
+    const DLXDataMemory& dataMemory = context.getDataMemory();
+    byteSwapData = dataMemory.isByteSwapNeeded();
+    //everything the generated code depends on besides the program
+    string options = string("arm7") + (byteSwapData ? " byteswap" : "") + " unroll=" + to_string(loopUnrollFactor);
+    if (finalRegistersKept)
+        options += " keepregs";
+    if (entryPosition > 0)
+        options += " entry=" + to_string(entryPosition);
+    if (executionCounting != COUNT_NOTHING)
+        options += executionCounting == COUNT_BLOCKS ? " count=blocks" : " count=instructions";
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    options += " neon";
+#endif
+    DLXCodeCache cache(codeCacheDirectory, instructions, options);
+    size_t footprint;
+    if (cache.load(rawCode, dlxOffsetsInRawCode, sourcePositions, footprint))
+        setDataMemoryFootprint(footprint);
+    else
+    {
+        generateCode();
+        cache.store(rawCode, dlxOffsetsInRawCode, sourcePositions, getDataMemoryFootprint());
+    }
+
+    DLXNativeProgram::SourceAddresses sourceAddresses;
+    sourceAddresses.reserve(sourcePositions.size());
+    for (InstructionCollection::size_type i = 0; i < sourcePositions.size(); i++)
+        sourceAddresses.push_back({ dlxOffsetsInRawCode[i], codContent[sourcePositions[i]].iaddr });
+    auto program = make_shared<DLXNativeProgram>(dataMemory.getByteOrder(), getDataMemoryFootprint(), getNumberOfCounters(),
+        rawCode.data(), rawCode.size(), move(sourceAddresses));
+    addToPerfMap((const uint8_t*)program->getCode(), rawCode.size(), dlxOffsetsInRawCode, sourcePositions);
     
-#if 1
+#if defined(DLXJIT_PRINT_LISTING)
     {
         cerr << "Compiled program size: " << rawCode.size() << " bytes" << "\r\n";
-        for (int i = 0; i < codContent.size(); i++)
+        for (InstructionCollection::size_type i = 0; i < sourcePositions.size(); i++)
         {
-                cerr << (codContent[i].label == "" ? "" : codContent[i].label+":") << "\t" << codContent[i].textInstruction->toString() << ":\t0x" << std::hex << (((unsigned long)mem) + dlxOffsetsInRawCode[i]) << "\r\n";
+                auto position = sourcePositions[i];
+                cerr << (codContent[position].label == "" ? "" : codContent[position].label+":") << "\t" << instructionToString(position) << ":\t0x" << std::hex << (((unsigned long)program->getCode()) + dlxOffsetsInRawCode[i]) << "\r\n";
         }
         cerr << std::dec;
     }
 #endif
-}
-
-
-
-void DLXJITArm7::execute() {
-    if(program == nullptr)
-        compile();
-    auto data_ptr = data.data();
-    program(data_ptr);
+    return program;
 }
 
 
 
 DLXJITArm7::~DLXJITArm7() {
-    if(program != nullptr)
-        munmap((void*)program, rawCode.size());
 }
 
 #endif
\ No newline at end of file
@@ -164,35 +164,32 @@ struct MediaInstuction
 
 class DLXJITArm7 : public DLXJIT {
 public:
-    typedef void(*DlxProgram)(uint8_t* data_memory);
     typedef std::vector<char> RawCodeContainer;
     
     DLXJITArm7();
 
-    std::size_t getDataMemorySize() override;
-    
-    void execute() override;
-
     ~DLXJITArm7() override;
-protected:
-    uint8_t loadByteFromMemory(std::size_t address) override;
-    void saveByteInMemory(std::size_t address, uint8_t data) override;
-    uint16_t loadHalfFromMemory(std::size_t address) override;
-    void saveHalfInMemory(std::size_t address, uint16_t data) override;
-    uint32_t loadWordFromMemory(std::size_t address) override;
-    void saveWordInMemory(std::size_t address, uint32_t data) override;
 private:
     void writeNop(Condition cond);
     void writeMov(Condition cond, bool updateFlags,Register dest, Register src);
-    void writeMov(Condition cond, bool updateFlags,Register dest, int16_t imm);
+    void writeMov(Condition cond, bool updateFlags,Register dest, int32_t imm);
+    void writeDataProcessingImmediate(Condition cond, uint8_t opcode, bool updateFlags, Register dest, Register src1, uint16_t encodedImm);
     
-    void writeAdd(Condition cond, bool updateFlags, Register dest, Register src1, int16_t imm);
+    void writeAdd(Condition cond, bool updateFlags, Register dest, Register src1, int32_t imm);
     void writeAdd(Condition cond, bool updateFlags, Register dest, Register src1, Register src2);
-    void writeSub(Condition cond, bool updateFlags, Register dest, Register src1, int16_t imm);
+    void writeSub(Condition cond, bool updateFlags, Register dest, Register src1, int32_t imm);
     void writeSub(Condition cond, bool updateFlags, Register dest, Register src1, Register src2);
+    void writeRsb(Condition cond, bool updateFlags, Register dest, Register src1, int32_t imm);
+    //adds imm and the carry flag
+    void writeAdc(Condition cond, Register dest, Register src1, uint8_t imm);
+    void writeCmp(Condition cond, Register src1, int32_t imm);
     void writeMul(Condition cond, bool updateFlags, Register dest, Register src1, Register src2);
     void writeMla(Condition cond, bool updateFlags, Register dest, Register src1, Register src2, Register src3);
     void writeRev(Condition cond, Register dst, Register src);
+    void writeAsr(Condition cond, Register dest, Register src, uint8_t shift);
+    //adds byte by byte, so the scratch register is not needed
+    void writeAddOffset(Register dest, int32_t offset);
+    void writeNeonInstruction(uint32_t encoding);
     
     void writeLDR(Condition cond, LoadStoreMode mode,  bool add, Register dst, Register base, uint16_t offset);
     void writeSTR(Condition cond, LoadStoreMode mode,  bool add, Register src, Register base, uint16_t offset);
@@ -203,30 +200,56 @@ private:
     void writePop(Condition cond, uint16_t registers);
     void writeB(Condition cond, int32_t offset);
     
+    bool isDLXRegisterMapped(int no);
+    Register getMappedRegister(int no);
     Register loadDLXRegister(int no, int argumentNumber);
+    int32_t writeDataAddress(int indexRegisterNo, int32_t offset);
     
     Register getRegisterForTargetDLXRegister(int no);
     void storeTargetDLXRegister(int no);
     
-    int32_t calcBranchOffset(CodCollection::size_type targetDlx, RawCodeContainer::size_type branchInstructionPosition);
+    int32_t calcBranchOffset(InstructionCollection::size_type targetDlx, RawCodeContainer::size_type branchInstructionPosition);
     
-    bool compileDLXInstruction(const DLXJITCodLine& line, const DLXJITCodLine& nextline);
+    void writeBranch(Condition cond, InstructionCollection::size_type targetDlx);
+    //jumps when cond holds, or predicates the instructions the branch skips after if-conversion
+    void writeConditionalBranch(Condition cond, const DLXInstruction& branch);
 
-    bool compileDLXInstruction(const DLXJITCodLine& line, const DLXJITCodLine& nextline, bool skip);
+    void compileDLXInstruction(const DLXInstruction& instr);
+    //instruction skipped by an if-converted branch, executed only when cond holds
+    void compilePredicatedInstruction(const DLXInstruction& instr, Condition cond);
+    //NEON body of OP_DOTW, 4 iterations at once
+    void writeDotProduct(const DLXInstruction& instr);
 
+    //registers from the context at the start of the program
+    void writeLoadDLXRegisters(uint32_t registers);
+    //all registers back to the context, when final values are kept
+    void writeStoreDLXRegisters();
+    int getRegistersPointerOffsetOnStack();
+    int getExecutionCountsPointerOffsetOnStack();
+    void writeCountExecution(InstructionCollection::size_type position);
     void repairBranchOffsets();
     
     //void compileDLXInstruction(const DLXJITCodLine& line);
 
-    void compile();
-    std::vector<uint8_t> data;
+    //fills rawCode, dlxOffsetsInRawCode and sourcePositions
+    void generateCode();
+    //generated or cached code is mapped into executable memory
+    std::shared_ptr<const DLXCompiledProgram> compile() override;
     RawCodeContainer rawCode;
+    //code offset of every optimized instruction, followed by the offset of the epilogue
     std::vector<RawCodeContainer::size_type> dlxOffsetsInRawCode;
-    DlxProgram program;
+    SourcePositions sourcePositions;
+    //position in allocatableRegisters for every DLX register, or DLXRegisterAllocator::SPILLED
+    std::vector<int> dlxRegisterAllocation;
+    //false when data memory is kept in host byte order
+    bool byteSwapData;
+    //instructions left to compile with compilePredicatedInstruction
+    unsigned predicatedInstructionsLeft;
+    Condition predicateCondition;
     
     struct JumpOffsetToRepair
     {
-            std::shared_ptr<DLXJTypeTextInstruction> dlxInstruction;
+            InstructionCollection::size_type targetDlx;
             RawCodeContainer::size_type branchInstructionOffset;
     };
 
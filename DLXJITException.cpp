@@ -1,4 +1,5 @@
 #include <string>
+#include <sstream>
 
 #include "DLXJITException.h"
 
@@ -27,3 +28,17 @@ const char* DLXJITException::what() const throw() {
 DLXJITException::~DLXJITException()
 {
 }
+
+static string memoryAccessMessage(uint32_t instructionAddress, uint32_t dataAddress)
+{
+	stringstream message;
+	message << "Data memory access out of range at DLX address 0x" << hex << instructionAddress
+		<< " (data address 0x" << dataAddress << ")";
+	return message.str();
+}
+
+DLXMemoryAccessException::DLXMemoryAccessException(uint32_t instructionAddress, uint32_t dataAddress)
+	: DLXJITException(memoryAccessMessage(instructionAddress, dataAddress)),
+	instructionAddress(instructionAddress), dataAddress(dataAddress)
+{
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <exception>
+#include <cstdint>
+#include <string>
 
 class DLXJITException : public std::exception
 {
@@ -13,4 +15,16 @@ public:
 
 
 	~DLXJITException() throw() override;
-};
\ No newline at end of file
+};
+
+//Load or store of a DLX instruction outside of data memory
+class DLXMemoryAccessException : public DLXJITException
+{
+	uint32_t instructionAddress;
+	uint32_t dataAddress;
+public:
+	DLXMemoryAccessException(uint32_t instructionAddress, uint32_t dataAddress);
+
+	uint32_t getInstructionAddress() const { return instructionAddress; }
+	uint32_t getDataAddress() const { return dataAddress; }
+};
@@ -0,0 +1,1155 @@
+/*
+ * File:   DLXJITX64.cpp
+ *
+ * x86-64 (System V ABI) counterpart of DLXJITArm7.cpp.
+ */
+
+#if defined(__x86_64__)
+#include "DLXJITX64.h"
+#include <endian.h>
+#include <cstring>
+#include <iostream>
+#include "utils.h"
+#include "DLXCodeCache.h"
+#include "DLXLivenessAnalysis.h"
+#include "DLXPerfMap.h"
+#include "DLXRegisterAllocator.h"
+
+using namespace std;
+
+#define DATA_POINTER_REGISTER RDI
+//second argument, pointer to the registers of the execution context
+#define REGISTERS_POINTER_REGISTER RSI
+//third argument, kept on the stack when executions are counted
+#define EXECUTION_COUNTS_POINTER_REGISTER RDX
+#define FIRST_ARGUMENT_CACHE_REGISTER RAX
+#define SECOND_ARGUMENT_CACHE_REGISTER RCX
+#define RESULT_CACHE_REGISTER RDX
+//RSP can not be encoded as an index in SIB byte, so it is used as "no index"
+#define NO_INDEX_REGISTER RSP
+//dlxOffsetsInRawCode of instructions whose block is not generated yet
+#define NOT_COMPILED SIZE_MAX
+
+//host registers handed out to DLX registers by DLXRegisterAllocator, the rest live on the stack
+static const Register allocatableRegisters[] = { RSI, R8, R9, R10, R11, RBX, RBP, R12, R13, R14, R15 };
+static const int numberOfAllocatableRegisters = sizeof(allocatableRegisters) / sizeof(allocatableRegisters[0]);
+static const Register calleeSavedRegisters[] = { RBX, RBP, R12, R13, R14, R15 };
+//registers a call may change, kept around DLXLazyNativeProgram::resolve
+static const Register callerSavedRegisters[] = { RAX, RCX, RDX, RSI, RDI, R8, R9, R10, R11 };
+static const int numberOfCallerSavedRegisters = sizeof(callerSavedRegisters) / sizeof(callerSavedRegisters[0]);
+
+template<typename T>
+inline void serialize(std::vector<char>& code, const T& serializable)
+{
+	const char* ptr = (const char*)&serializable;
+	for (size_t i = 0; i < sizeof(T); i++)
+		code.push_back(ptr[i]);
+}
+
+inline int getDLXRegisterOffsetOnStack(int regNumber)
+{
+	return regNumber * 4;
+}
+
+inline int getDLXRegisterOffsetInContext(int regNumber)
+{
+	return regNumber * 4;
+}
+
+inline bool fitsInInt8(int32_t value)
+{
+    return value >= -128 && value <= 127;
+}
+
+
+DLXJITX64::DLXJITX64()
+    : byteSwapData(true), predicatedInstructionsLeft(0), predicateCondition(CC_O)
+{
+}
+
+void DLXJITX64::writeRex(bool wide, Register reg, Register index, Register base)
+{
+    uint8_t rex = 0x40 |
+                  (wide ? 0x8 : 0) |
+                  (reg >= R8 ? 0x4 : 0) |
+                  (index >= R8 ? 0x2 : 0) |
+                  (base >= R8 ? 0x1 : 0);
+    if (rex != 0x40)
+        serialize(rawCode, rex);
+}
+
+void DLXJITX64::writeModRM(uint8_t mod, uint8_t reg, uint8_t rm)
+{
+    uint8_t modrm = mod << 6 | (reg & 0x7) << 3 | (rm & 0x7);
+    serialize(rawCode, modrm);
+}
+
+void DLXJITX64::writeMemoryOperand(Register reg, Register base, Register index, int32_t displacement)
+{
+    uint8_t mod;
+    if (displacement == 0 && (base & 0x7) != RBP)
+        mod = 0x0;
+    else if (fitsInInt8(displacement))
+        mod = 0x1;
+    else
+        mod = 0x2;
+
+    if (index == NO_INDEX_REGISTER && (base & 0x7) != RSP)
+    {
+        writeModRM(mod, reg, base);
+    }
+    else
+    {
+        writeModRM(mod, reg, RSP);
+        uint8_t sib = (index & 0x7) << 3 | (base & 0x7);
+        serialize(rawCode, sib);
+    }
+
+    if (mod == 0x1)
+        serialize(rawCode, (int8_t)displacement);
+    else if (mod == 0x2)
+        serialize(rawCode, displacement);
+}
+
+void DLXJITX64::writeRegisterInstruction(uint8_t opcode, bool wide, Register reg, Register rm)
+{
+    writeRex(wide, reg, RAX, rm);
+    serialize(rawCode, opcode);
+    writeModRM(0x3, reg, rm);
+}
+
+void DLXJITX64::writeNop()
+{
+    serialize(rawCode, (uint8_t)0x90);
+}
+
+void DLXJITX64::writeMov(Register dest, Register src)
+{
+    writeRegisterInstruction(0x89, false, src, dest);
+}
+
+void DLXJITX64::writeMov(bool wide, Register dest, Register src)
+{
+    writeRegisterInstruction(0x89, wide, src, dest);
+}
+
+void DLXJITX64::writeMov(Register dest, int32_t imm)
+{
+    writeRex(false, RAX, RAX, dest);
+    serialize(rawCode, (uint8_t)(0xB8 | (dest & 0x7)));
+    serialize(rawCode, imm);
+}
+
+void DLXJITX64::writeAdd(Register dest, Register src)
+{
+    writeRegisterInstruction(0x01, false, src, dest);
+}
+
+void DLXJITX64::writeAdd(bool wide, Register dest, int32_t imm)
+{
+    writeRex(wide, RAX, RAX, dest);
+    if (fitsInInt8(imm))
+    {
+        serialize(rawCode, (uint8_t)0x83);
+        writeModRM(0x3, 0x0, dest);
+        serialize(rawCode, (int8_t)imm);
+    }
+    else
+    {
+        serialize(rawCode, (uint8_t)0x81);
+        writeModRM(0x3, 0x0, dest);
+        serialize(rawCode, imm);
+    }
+}
+
+void DLXJITX64::writeAdd(bool wide, Register dest, Register src)
+{
+    writeRegisterInstruction(0x01, wide, src, dest);
+}
+
+void DLXJITX64::writeSub(Register dest, Register src)
+{
+    writeRegisterInstruction(0x29, false, src, dest);
+}
+
+void DLXJITX64::writeSub(bool wide, Register dest, Register src)
+{
+    writeRegisterInstruction(0x29, wide, src, dest);
+}
+
+void DLXJITX64::writeXor(Register dest, Register src)
+{
+    writeRegisterInstruction(0x31, false, src, dest);
+}
+
+void DLXJITX64::writeSub(bool wide, Register dest, int32_t imm)
+{
+    writeRex(wide, RAX, RAX, dest);
+    if (fitsInInt8(imm))
+    {
+        serialize(rawCode, (uint8_t)0x83);
+        writeModRM(0x3, 0x5, dest);
+        serialize(rawCode, (int8_t)imm);
+    }
+    else
+    {
+        serialize(rawCode, (uint8_t)0x81);
+        writeModRM(0x3, 0x5, dest);
+        serialize(rawCode, imm);
+    }
+}
+
+void DLXJITX64::writeAnd(bool wide, Register dest, int32_t imm)
+{
+    writeRex(wide, RAX, RAX, dest);
+    if (fitsInInt8(imm))
+    {
+        serialize(rawCode, (uint8_t)0x83);
+        writeModRM(0x3, 0x4, dest);
+        serialize(rawCode, (int8_t)imm);
+    }
+    else
+    {
+        serialize(rawCode, (uint8_t)0x81);
+        writeModRM(0x3, 0x4, dest);
+        serialize(rawCode, imm);
+    }
+}
+
+void DLXJITX64::writeIncrement(Register base, int32_t displacement)
+{
+    writeRex(true, RAX, NO_INDEX_REGISTER, base);
+    serialize(rawCode, (uint8_t)0x83);
+    writeMemoryOperand(RAX, base, NO_INDEX_REGISTER, displacement);
+    serialize(rawCode, (uint8_t)1);
+}
+
+void DLXJITX64::writeNeg(Register dest)
+{
+    writeRex(false, RAX, RAX, dest);
+    serialize(rawCode, (uint8_t)0xF7);
+    writeModRM(0x3, 0x3, dest);
+}
+
+void DLXJITX64::writeImul(Register dest, Register src)
+{
+    writeRex(false, dest, RAX, src);
+    serialize(rawCode, (uint8_t)0x0F);
+    serialize(rawCode, (uint8_t)0xAF);
+    writeModRM(0x3, dest, src);
+}
+
+void DLXJITX64::writeBswap(Register dest)
+{
+    writeRex(false, RAX, RAX, dest);
+    serialize(rawCode, (uint8_t)0x0F);
+    serialize(rawCode, (uint8_t)(0xC8 | (dest & 0x7)));
+}
+
+void DLXJITX64::writeTest(Register src1, Register src2)
+{
+    writeRegisterInstruction(0x85, false, src2, src1);
+}
+
+void DLXJITX64::writeCmp(Register src1, Register src2)
+{
+    writeRegisterInstruction(0x39, false, src2, src1);
+}
+
+void DLXJITX64::writeCmov(Condition cond, Register dest, Register src)
+{
+    writeRex(false, dest, RAX, src);
+    serialize(rawCode, (uint8_t)0x0F);
+    serialize(rawCode, (uint8_t)(0x40 | cond));
+    writeModRM(0x3, dest, src);
+}
+
+void DLXJITX64::writeSar(Register dest, uint8_t shift)
+{
+    writeRex(false, RAX, RAX, dest);
+    serialize(rawCode, (uint8_t)0xC1);
+    writeModRM(0x3, 0x7, dest);
+    serialize(rawCode, shift);
+}
+
+void DLXJITX64::writeLea(Register dest, Register base, Register index, int32_t displacement)
+{
+    writeRex(false, dest, index, base);
+    serialize(rawCode, (uint8_t)0x8D);
+    writeMemoryOperand(dest, base, index, displacement);
+}
+
+void DLXJITX64::writeMovabs(Register dest, uint64_t imm)
+{
+    writeRex(true, RAX, RAX, dest);
+    serialize(rawCode, (uint8_t)(0xB8 | (dest & 0x7)));
+    serialize(rawCode, imm);
+}
+
+void DLXJITX64::writeSimdInstruction(uint8_t prefix, std::initializer_list<uint8_t> opcode, bool wide, int xmm, Register rm, bool memoryOperand)
+{
+    //mandatory prefix goes before REX
+    serialize(rawCode, prefix);
+    writeRex(wide, (Register)xmm, RAX, rm);
+    for (auto byte : opcode)
+        serialize(rawCode, byte);
+    if (memoryOperand)
+        writeMemoryOperand((Register)xmm, rm, NO_INDEX_REGISTER, 0);
+    else
+        writeModRM(0x3, xmm, rm);
+}
+
+void DLXJITX64::writeLoad(Register dst, Register base, Register index, int32_t offset)
+{
+    writeLoad(false, dst, base, index, offset);
+}
+
+void DLXJITX64::writeLoad(bool wide, Register dst, Register base, Register index, int32_t offset)
+{
+    writeRex(wide, dst, index, base);
+    serialize(rawCode, (uint8_t)0x8B);
+    writeMemoryOperand(dst, base, index, offset);
+}
+
+void DLXJITX64::writeStore(Register src, Register base, Register index, int32_t offset)
+{
+    writeStore(false, src, base, index, offset);
+}
+
+void DLXJITX64::writeStore(bool wide, Register src, Register base, Register index, int32_t offset)
+{
+    writeRex(wide, src, index, base);
+    serialize(rawCode, (uint8_t)0x89);
+    writeMemoryOperand(src, base, index, offset);
+}
+
+void DLXJITX64::writePush(Register src)
+{
+    writeRex(false, RAX, RAX, src);
+    serialize(rawCode, (uint8_t)(0x50 | (src & 0x7)));
+}
+
+void DLXJITX64::writePush(int32_t imm)
+{
+    serialize(rawCode, (uint8_t)0x68);
+    serialize(rawCode, imm);
+}
+
+void DLXJITX64::writePop(Register dst)
+{
+    writeRex(false, RAX, RAX, dst);
+    serialize(rawCode, (uint8_t)(0x58 | (dst & 0x7)));
+}
+
+void DLXJITX64::writeCall(Register target)
+{
+    writeRex(false, RAX, RAX, target);
+    serialize(rawCode, (uint8_t)0xFF);
+    writeModRM(0x3, 0x2, target);
+}
+
+void DLXJITX64::writeRet()
+{
+    serialize(rawCode, (uint8_t)0xC3);
+}
+
+void DLXJITX64::writeJcc(Condition cond, int32_t offset)
+{
+    serialize(rawCode, (uint8_t)0x0F);
+    serialize(rawCode, (uint8_t)(0x80 | cond));
+    serialize(rawCode, offset);
+}
+
+void DLXJITX64::writeJmp(int32_t offset)
+{
+    serialize(rawCode, (uint8_t)0xE9);
+    serialize(rawCode, offset);
+}
+
+bool DLXJITX64::isDLXRegisterMapped(int no) {
+    return no > 0 && dlxRegisterAllocation[no] != DLXRegisterAllocator::SPILLED;
+}
+
+Register DLXJITX64::getMappedRegister(int no) {
+    return allocatableRegisters[dlxRegisterAllocation[no]];
+}
+
+Register DLXJITX64::loadDLXRegister(int no, int argumentNumber) {
+    if (isDLXRegisterMapped(no))
+    {
+        return getMappedRegister(no);
+    }
+    else
+    {
+        Register ret;
+        if (argumentNumber == 2)
+            ret = RESULT_CACHE_REGISTER;
+        else
+            ret = argumentNumber == 0 ? FIRST_ARGUMENT_CACHE_REGISTER : SECOND_ARGUMENT_CACHE_REGISTER;
+        if (no == 0)
+        {
+            writeMov(ret, 0);
+        }
+        else
+        {
+            writeLoad(ret, RSP, NO_INDEX_REGISTER, getDLXRegisterOffsetOnStack(no));
+        }
+        return ret;
+    }
+}
+
+Register DLXJITX64::getAddressRegister(int no, int32_t& offset, Register scratch) {
+    //32 bit operations zero the upper half, so host registers can be used as 64 bit index as they are;
+    //the sum with the offset wraps at 32 bits like in the interpreter, so it is formed by a 32 bit LEA
+    if (no == 0)
+    {
+        if (offset >= 0)
+            return NO_INDEX_REGISTER;
+        writeMov(scratch, offset);
+        offset = 0;
+        return scratch;
+    }
+    Register reg = loadDLXRegister(no, 0);
+    if (offset == 0)
+        return reg;
+    writeLea(scratch, reg, NO_INDEX_REGISTER, offset);
+    offset = 0;
+    return scratch;
+}
+
+Register DLXJITX64::getRegisterForTargetDLXRegister(int no) {
+    if (isDLXRegisterMapped(no))
+    {
+        return getMappedRegister(no);
+    }
+
+    return RESULT_CACHE_REGISTER;
+}
+
+void DLXJITX64::storeTargetDLXRegister(int no) {
+    if (isDLXRegisterMapped(no))
+    {
+        //NOP
+        return;
+    }
+
+    writeStore(RESULT_CACHE_REGISTER, RSP, NO_INDEX_REGISTER, getDLXRegisterOffsetOnStack(no));
+}
+
+int32_t DLXJITX64::calcBranchOffset(InstructionCollection::size_type targetDlx, RawCodeContainer::size_type branchOffsetPosition) {
+    return dlxOffsetsInRawCode[targetDlx] - (branchOffsetPosition + sizeof(int32_t));
+}
+
+bool DLXJITX64::isDLXInstructionCompiled(InstructionCollection::size_type position) {
+    return dlxOffsetsInRawCode.size() > position && dlxOffsetsInRawCode[position] != NOT_COMPILED;
+}
+
+void DLXJITX64::alignBranchOffset(RawCodeContainer::size_type opcodeSize, InstructionCollection::size_type targetDlx) {
+    //rel32 of branches to stubs is patched by a single store while the code may run
+    if (lazyCompilation && !isDLXInstructionCompiled(targetDlx))
+    {
+        while ((rawCode.size() + opcodeSize) % sizeof(int32_t) != 0)
+            writeNop();
+    }
+}
+
+void DLXJITX64::writeBranch(Condition cond, InstructionCollection::size_type targetDlx) {
+    alignBranchOffset(2, targetDlx);
+    //rel32 follows two opcode bytes of Jcc
+    auto branchOffsetPosition = rawCode.size() + 2;
+    int32_t offset = 0;
+
+    if (isDLXInstructionCompiled(targetDlx))
+        offset = calcBranchOffset(targetDlx, branchOffsetPosition);
+    else
+        jumpOffsetsToRepair.push_back({ targetDlx, branchOffsetPosition });
+
+    writeJcc(cond, offset);
+}
+
+void DLXJITX64::writeJump(InstructionCollection::size_type targetDlx) {
+    alignBranchOffset(1, targetDlx);
+    //rel32 follows one opcode byte of JMP
+    auto branchOffsetPosition = rawCode.size() + 1;
+    int32_t offset = 0;
+
+    if (isDLXInstructionCompiled(targetDlx))
+        offset = calcBranchOffset(targetDlx, branchOffsetPosition);
+    else
+        jumpOffsetsToRepair.push_back({ targetDlx, branchOffsetPosition });
+
+    writeJmp(offset);
+}
+
+void DLXJITX64::writeConditionalBranch(Condition cond, const DLXInstruction& branch) {
+    if (branch.predicated == 0)
+    {
+        writeBranch(cond, branch.target);
+        return;
+    }
+    //conditions come in pairs, the lowest bit negates them
+    predicateCondition = (Condition)(cond ^ 1);
+    predicatedInstructionsLeft = branch.predicated;
+}
+
+
+void DLXJITX64::compileDLXInstruction(const DLXInstruction& instr) {
+    switch (instr.opcode)
+    {
+    case OP_ADD:
+        if (instr.rd > 0)
+        {
+            Register src1 = loadDLXRegister(instr.rs1, 0);
+            Register src2 = loadDLXRegister(instr.rs2, 1);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            if (dst == src2 && dst != src1)
+            {
+                writeAdd(dst, src1);
+            }
+            else
+            {
+                if (dst != src1)
+                    writeMov(dst, src1);
+                writeAdd(dst, src2);
+            }
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_ADDI:
+    case OP_SUBI:
+        if (instr.rd > 0)
+        {
+            int32_t imm = instr.opcode == OP_ADDI ? instr.imm : -instr.imm;
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            if (instr.rs1 == 0)
+            {
+                writeMov(dst, imm);
+            }
+            else
+            {
+                Register src = loadDLXRegister(instr.rs1, 0);
+                if (dst != src)
+                    writeMov(dst, src);
+                if (imm != 0)
+                    writeAdd(false, dst, imm);
+            }
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_MULADD:
+        if (instr.rd > 0)
+        {
+            Register mul_src1 = loadDLXRegister(instr.rs1, 0);
+            Register mul_src2 = loadDLXRegister(instr.rs2, 1);
+            Register add_src = loadDLXRegister(instr.rd, 2);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            if (mul_src1 != FIRST_ARGUMENT_CACHE_REGISTER)
+                writeMov(FIRST_ARGUMENT_CACHE_REGISTER, mul_src1);
+            writeImul(FIRST_ARGUMENT_CACHE_REGISTER, mul_src2);
+            if (dst != add_src)
+                writeMov(dst, add_src);
+            writeAdd(dst, FIRST_ARGUMENT_CACHE_REGISTER);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_LOOPCHECK:
+    case OP_LOOPCHECK_BRLE:
+    case OP_LOOPCHECK_BRGE:
+        //result of a fused branch that is never read is computed only for the flags
+        if (instr.rd > 0 || instr.opcode != OP_LOOPCHECK) //writing to R0 is not allowed
+        {
+            //LOOPCHECK subtracts source register from the immediate
+            Register src = loadDLXRegister(instr.rs1, 0);
+            Register dst = instr.rd > 0 ? getRegisterForTargetDLXRegister(instr.rd) : RESULT_CACHE_REGISTER;
+            if (dst == src)
+            {
+                writeNeg(dst);
+                writeAdd(false, dst, instr.imm);
+            }
+            else
+            {
+                writeMov(dst, instr.imm);
+                writeSub(dst, src);
+            }
+            if (instr.rd > 0)
+                storeTargetDLXRegister(instr.rd);
+            //SF is the sign of the result, OF of the subtraction is not valid for a comparison with 0
+            if (instr.opcode == OP_LOOPCHECK_BRGE)
+            {
+                writeConditionalBranch(CC_NS, instr);
+            }
+            else if (instr.opcode == OP_LOOPCHECK_BRLE)
+            {
+                writeTest(dst, dst);
+                writeConditionalBranch(CC_LE, instr);
+            }
+        }
+        break;
+    case OP_LI:
+        if (instr.rd > 0)
+        {
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            if (instr.imm == 0)
+                writeXor(dst, dst);
+            else
+                writeMov(dst, instr.imm);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_MOV:
+        if (instr.rd > 0)
+        {
+            Register src = loadDLXRegister(instr.rs1, 0);
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            if (dst != src)
+                writeMov(dst, src);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_COPYW:
+        {
+            //word is copied as it is, so only the register value needs to be swapped
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            int32_t ldwOffset = instr.imm;
+            Register ldw_indexRegister = getAddressRegister(instr.rs1, ldwOffset, dst);
+            writeLoad(dst, DATA_POINTER_REGISTER, ldw_indexRegister, ldwOffset);
+            //never handed out to DLX registers, so it is not dst
+            int32_t stwOffset = instr.imm2;
+            Register stw_indexRegister = getAddressRegister(instr.rs2, stwOffset, SECOND_ARGUMENT_CACHE_REGISTER);
+            writeStore(dst, DATA_POINTER_REGISTER, stw_indexRegister, stwOffset);
+            if (byteSwapData)
+                writeBswap(dst);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_LDW:
+        if (instr.rd > 0)
+        {
+            //the address goes to the register that is loaded anyway
+            Register dst = getRegisterForTargetDLXRegister(instr.rd);
+            int32_t offset = instr.imm;
+            Register indexRegister = getAddressRegister(instr.rs1, offset, dst);
+            writeLoad(dst, DATA_POINTER_REGISTER, indexRegister, offset);
+            if (byteSwapData)
+                writeBswap(dst);
+            storeTargetDLXRegister(instr.rd);
+        }
+        break;
+    case OP_STW:
+        {
+            //STW has no result, the result register holds the address
+            int32_t offset = instr.imm;
+            Register indexRegister = getAddressRegister(instr.rs1, offset, RESULT_CACHE_REGISTER);
+            Register src = loadDLXRegister(instr.rs2, 1);
+            if (byteSwapData)
+            {
+                if (src != SECOND_ARGUMENT_CACHE_REGISTER)
+                    writeMov(SECOND_ARGUMENT_CACHE_REGISTER, src);
+                writeBswap(SECOND_ARGUMENT_CACHE_REGISTER);
+                src = SECOND_ARGUMENT_CACHE_REGISTER;
+            }
+            writeStore(src, DATA_POINTER_REGISTER, indexRegister, offset);
+        }
+        break;
+    case OP_BRLE:
+    case OP_BRGE:
+        //R0 compares equal to 0, so the branch is always taken
+        if (instr.rs1 == 0)
+        {
+            writeJump(instr.target);
+            break;
+        }
+        {
+            Register reg = loadDLXRegister(instr.rs1, 0);
+            writeTest(reg, reg);
+            writeConditionalBranch(instr.opcode == OP_BRLE ? CC_LE : CC_GE, instr);
+        }
+        break;
+    case OP_DOTW:
+        //without SSE4.1 the loop runs alone
+        if (__builtin_cpu_supports("sse4.1"))
+            writeDotProduct(instr);
+        break;
+    case OP_NOP:
+        //NOP ;)
+        break;
+    default:
+        {
+            string message = string("Unsupported DLX opcode: ") + getOpcodeName(instr.opcode);
+            throw DLXJITException(message.c_str());
+        }
+    }
+}
+
+void DLXJITX64::compilePredicatedInstruction(const DLXInstruction& instr, Condition cond) {
+    if (instr.opcode == OP_NOP || instr.rd == 0)
+        return;
+    //the value is computed without changing flags of the branch, then moved if cond holds
+    Register value = RESULT_CACHE_REGISTER;
+    switch (instr.opcode)
+    {
+    case OP_ADD:
+        {
+            Register src1 = loadDLXRegister(instr.rs1, 0);
+            Register src2 = loadDLXRegister(instr.rs2, 1);
+            writeLea(value, src1, src2, 0);
+        }
+        break;
+    case OP_ADDI:
+    case OP_SUBI:
+        {
+            int32_t imm = instr.opcode == OP_ADDI ? instr.imm : -instr.imm;
+            if (instr.rs1 == 0)
+                writeMov(value, imm);
+            else
+                writeLea(value, loadDLXRegister(instr.rs1, 0), NO_INDEX_REGISTER, imm);
+        }
+        break;
+    case OP_LI:
+        writeMov(value, instr.imm);
+        break;
+    case OP_MOV:
+        value = loadDLXRegister(instr.rs1, 0);
+        break;
+    default:
+        {
+            string message = string("DLX opcode can not be predicated: ") + getOpcodeName(instr.opcode);
+            throw DLXJITException(message.c_str());
+        }
+    }
+
+    if (isDLXRegisterMapped(instr.rd))
+    {
+        writeCmov(cond, getMappedRegister(instr.rd), value);
+    }
+    else
+    {
+        Register dst = loadDLXRegister(instr.rd, 1);
+        writeCmov(cond, dst, value);
+        writeStore(dst, RSP, NO_INDEX_REGISTER, getDLXRegisterOffsetOnStack(instr.rd));
+    }
+}
+
+void DLXJITX64::writeLimitDistance(Register dest, Register pointer, int32_t limit) {
+    if (dest == pointer)
+    {
+        writeNeg(dest);
+        writeAdd(false, dest, limit);
+    }
+    else
+    {
+        writeMov(dest, limit);
+        writeSub(dest, pointer);
+    }
+}
+
+void DLXJITX64::writeDotProduct(const DLXInstruction& instr) {
+    //xmm7 reverses bytes of every word
+    static const uint64_t byteSwapMaskLow = 0x0405060700010203ull;
+    static const uint64_t byteSwapMaskHigh = 0x0C0D0E0F08090A0Bull;
+
+    //eax = number of 4 word vectors the loop runs before its exit or a wrap
+    Register pointerA = loadDLXRegister(instr.rs1, 0);
+    writeLimitDistance(RAX, pointerA, lowHalf(instr.imm2));
+    Register pointerB = loadDLXRegister(instr.rs2, 2);
+    writeLimitDistance(RDX, pointerB, highHalf(instr.imm2));
+    writeCmp(RAX, RDX);
+    writeCmov(CC_G, RAX, RDX);
+    writeSar(RAX, 4);
+    writeTest(RAX, RAX);
+    auto skipPosition = rawCode.size();
+    writeJcc(CC_LE, 0);
+    writeMov(RDX, RAX);
+
+    if (byteSwapData)
+    {
+        writeMovabs(RAX, byteSwapMaskLow);
+        writeSimdInstruction(0x66, { 0x0F, 0x6E }, true, 7, RAX, false); //movq xmm7, rax
+        writeMovabs(RAX, byteSwapMaskHigh);
+        writeSimdInstruction(0x66, { 0x0F, 0x3A, 0x22 }, true, 7, RAX, false); //pinsrq xmm7, rax, 1
+        serialize(rawCode, (uint8_t)1);
+    }
+    //rax and rcx point to the words in host memory, the DLX addresses wrap at 32 bits
+    pointerA = loadDLXRegister(instr.rs1, 0);
+    writeLea(RAX, pointerA, NO_INDEX_REGISTER, lowHalf(instr.imm));
+    writeAdd(true, RAX, DATA_POINTER_REGISTER);
+    pointerB = loadDLXRegister(instr.rs2, 1);
+    writeLea(RCX, pointerB, NO_INDEX_REGISTER, highHalf(instr.imm));
+    writeAdd(true, RCX, DATA_POINTER_REGISTER);
+    writeSimdInstruction(0x66, { 0x0F, 0xEF }, false, 0, (Register)0, false); //pxor xmm0, xmm0
+
+    auto loopPosition = rawCode.size();
+    writeSimdInstruction(0xF3, { 0x0F, 0x6F }, false, 1, RAX, true); //movdqu xmm1, [rax]
+    writeSimdInstruction(0xF3, { 0x0F, 0x6F }, false, 2, RCX, true); //movdqu xmm2, [rcx]
+    if (byteSwapData)
+    {
+        writeSimdInstruction(0x66, { 0x0F, 0x38, 0x00 }, false, 1, (Register)7, false); //pshufb xmm1, xmm7
+        writeSimdInstruction(0x66, { 0x0F, 0x38, 0x00 }, false, 2, (Register)7, false); //pshufb xmm2, xmm7
+    }
+    writeSimdInstruction(0x66, { 0x0F, 0x38, 0x40 }, false, 1, (Register)2, false); //pmulld xmm1, xmm2
+    writeSimdInstruction(0x66, { 0x0F, 0xFE }, false, 0, (Register)1, false); //paddd xmm0, xmm1
+    writeAdd(true, RAX, 16);
+    writeAdd(true, RCX, 16);
+    writeSub(false, RDX, 1);
+    writeJcc(CC_NE, loopPosition - (rawCode.size() + 6));
+
+    //pointers are taken back from the addresses
+    writeSub(true, RAX, DATA_POINTER_REGISTER);
+    writeSub(false, RAX, lowHalf(instr.imm));
+    Register dst = getRegisterForTargetDLXRegister(instr.rs1);
+    writeMov(dst, RAX);
+    storeTargetDLXRegister(instr.rs1);
+    if (instr.rs2 != instr.rs1)
+    {
+        writeSub(true, RCX, DATA_POINTER_REGISTER);
+        writeSub(false, RCX, highHalf(instr.imm));
+        dst = getRegisterForTargetDLXRegister(instr.rs2);
+        writeMov(dst, RCX);
+        storeTargetDLXRegister(instr.rs2);
+    }
+
+    //horizontal sum of the 4 lanes
+    writeSimdInstruction(0x66, { 0x0F, 0x70 }, false, 1, (Register)0, false); //pshufd xmm1, xmm0, 0x4E
+    serialize(rawCode, (uint8_t)0x4E);
+    writeSimdInstruction(0x66, { 0x0F, 0xFE }, false, 0, (Register)1, false);
+    writeSimdInstruction(0x66, { 0x0F, 0x70 }, false, 1, (Register)0, false); //pshufd xmm1, xmm0, 0xB1
+    serialize(rawCode, (uint8_t)0xB1);
+    writeSimdInstruction(0x66, { 0x0F, 0xFE }, false, 0, (Register)1, false);
+    writeSimdInstruction(0x66, { 0x0F, 0x7E }, false, 0, RAX, false); //movd eax, xmm0
+    Register addSrc = loadDLXRegister(instr.rd, 1);
+    dst = getRegisterForTargetDLXRegister(instr.rd);
+    if (dst != addSrc)
+        writeMov(dst, addSrc);
+    writeAdd(dst, RAX);
+    storeTargetDLXRegister(instr.rd);
+
+    int32_t skipOffset = rawCode.size() - (skipPosition + 6);
+    memcpy(&rawCode[skipPosition + 2], &skipOffset, sizeof(skipOffset));
+}
+
+void DLXJITX64::writeLoadDLXRegisters(uint32_t registers) {
+    //initial values come from the context, only the ones read before written are needed
+    int pointerHolder = 0;
+    for (int no = 1; no < numberOfDLXRegisters; no++)
+    {
+        if (!(registers & (1u << no)))
+            continue;
+        if (!isDLXRegisterMapped(no))
+        {
+            writeLoad(FIRST_ARGUMENT_CACHE_REGISTER, REGISTERS_POINTER_REGISTER, NO_INDEX_REGISTER, getDLXRegisterOffsetInContext(no));
+            writeStore(FIRST_ARGUMENT_CACHE_REGISTER, RSP, NO_INDEX_REGISTER, getDLXRegisterOffsetOnStack(no));
+        }
+        else if (getMappedRegister(no) == REGISTERS_POINTER_REGISTER)
+            pointerHolder = no;
+        else
+            writeLoad(getMappedRegister(no), REGISTERS_POINTER_REGISTER, NO_INDEX_REGISTER, getDLXRegisterOffsetInContext(no));
+    }
+    //the pointer is overwritten last
+    if (pointerHolder != 0)
+        writeLoad(REGISTERS_POINTER_REGISTER, REGISTERS_POINTER_REGISTER, NO_INDEX_REGISTER, getDLXRegisterOffsetInContext(pointerHolder));
+}
+
+void DLXJITX64::writeStoreDLXRegisters() {
+    writeLoad(true, FIRST_ARGUMENT_CACHE_REGISTER, RSP, NO_INDEX_REGISTER, getRegistersPointerOffsetOnStack());
+    for (int no = 1; no < numberOfDLXRegisters; no++)
+    {
+        Register value = loadDLXRegister(no, 1);
+        writeStore(value, FIRST_ARGUMENT_CACHE_REGISTER, NO_INDEX_REGISTER, getDLXRegisterOffsetInContext(no));
+    }
+}
+
+int DLXJITX64::getRegistersPointerOffsetOnStack() {
+    return getDLXRegisterOffsetOnStack(numberOfDLXRegisters);
+}
+
+int DLXJITX64::getExecutionCountsPointerOffsetOnStack() {
+    return getRegistersPointerOffsetOnStack() + (finalRegistersKept ? 8 : 0);
+}
+
+int32_t DLXJITX64::getFrameSize() {
+    //spilled DLX registers, followed by the registers pointer when final values are kept
+    //and the execution counts pointer when they are counted
+    return numberOfDLXRegisters * 4 + (finalRegistersKept ? 8 : 0) + (executionCounting != COUNT_NOTHING ? 8 : 0);
+}
+
+void DLXJITX64::writeCountExecution(InstructionCollection::size_type position) {
+    //flags are not live between DLX instructions
+    writeLoad(true, FIRST_ARGUMENT_CACHE_REGISTER, RSP, NO_INDEX_REGISTER, getExecutionCountsPointerOffsetOnStack());
+    writeIncrement(FIRST_ARGUMENT_CACHE_REGISTER, position * sizeof(uint64_t));
+}
+
+void DLXJITX64::repairBranchOffsets() {
+    for (auto& toRepair : this->jumpOffsetsToRepair)
+    {
+        int32_t offset = calcBranchOffset(toRepair.targetDlx, toRepair.branchOffsetPosition);
+        memcpy(&rawCode[toRepair.branchOffsetPosition], &offset, sizeof(offset));
+    }
+}
+
+
+
+uint32_t DLXJITX64::prepareCode(InstructionCollection& optimized) {
+    rawCode.clear();
+    rawCode.reserve(instructions.size() * 16);
+    dlxOffsetsInRawCode.clear();
+    jumpOffsetsToRepair.clear();
+
+    optimizeInstructions(optimized, sourcePositions);
+
+    DLXLivenessAnalysis liveness(optimized, getRegistersLiveOnExit());
+    DLXRegisterAllocator allocator(optimized, liveness, numberOfDLXRegisters, numberOfAllocatableRegisters);
+    dlxRegisterAllocation.resize(numberOfDLXRegisters);
+    for (int no = 0; no < numberOfDLXRegisters; no++)
+        dlxRegisterAllocation[no] = allocator.getHostRegister(no);
+    countedPositions = getCountedPositions();
+    return liveness.getLiveOnEntry();
+}
+
+void DLXJITX64::writePrologue(uint32_t liveOnEntry) {
+    for (auto reg : calleeSavedRegisters)
+        writePush(reg);
+    writeSub(true, RSP, getFrameSize());
+    if (finalRegistersKept)
+        writeStore(true, REGISTERS_POINTER_REGISTER, RSP, NO_INDEX_REGISTER, getRegistersPointerOffsetOnStack());
+    if (executionCounting != COUNT_NOTHING)
+        writeStore(true, EXECUTION_COUNTS_POINTER_REGISTER, RSP, NO_INDEX_REGISTER, getExecutionCountsPointerOffsetOnStack());
+    writeLoadDLXRegisters(liveOnEntry);
+}
+
+DLXJITX64::RawCodeContainer::size_type DLXJITX64::writeEpilogue() {
+    if (finalRegistersKept)
+        writeStoreDLXRegisters();
+    auto exitOffset = rawCode.size();
+    writeAdd(true, RSP, getFrameSize());
+    for (int i = sizeof(calleeSavedRegisters) / sizeof(calleeSavedRegisters[0]) - 1; i >= 0; i--)
+        writePop(calleeSavedRegisters[i]);
+    writeRet();
+    return exitOffset;
+}
+
+void DLXJITX64::generateCode() {
+    InstructionCollection optimized;
+    writePrologue(prepareCode(optimized));
+    predicatedInstructionsLeft = 0;
+    for (InstructionCollection::size_type i = 0; i < optimized.size(); i++)
+    {
+            const auto& instr = optimized[i];
+            dlxOffsetsInRawCode.push_back(rawCode.size());
+            if (countedPositions[sourcePositions[i]])
+                writeCountExecution(sourcePositions[i]);
+            if (predicatedInstructionsLeft > 0)
+            {
+                compilePredicatedInstruction(instr, predicateCondition);
+                predicatedInstructionsLeft--;
+            }
+            else
+            {
+                compileDLXInstruction(instr);
+            }
+    }
+    //branches past the last instruction land on the epilogue
+    dlxOffsetsInRawCode.push_back(rawCode.size());
+    writeEpilogue();
+    repairBranchOffsets();
+}
+
+size_t DLXJITX64::prepareLazyCode() {
+    lazyLiveOnEntry = prepareCode(lazyInstructions);
+    auto count = lazyInstructions.size();
+    dlxOffsetsInRawCode.assign(count + 1, NOT_COMPILED);
+    stubOffsets.assign(count + 1, 0);
+    branchesToStubs.clear();
+
+    //prologue, epilogue and the trampoline
+    size_t capacity = 256 + numberOfDLXRegisters * 32;
+    blockStarts.assign(count + 1, false);
+    blockStarts[0] = true;
+    blockStarts[count] = true;
+    for (InstructionCollection::size_type i = 0; i < count; i++)
+    {
+        const auto& instr = lazyInstructions[i];
+        if (isBranch(instr) && instr.predicated == 0)
+        {
+            blockStarts[instr.target] = true;
+            blockStarts[i + 1] = true;
+        }
+        //most code of one instruction, its execution count, the jump at the end of its block and a stub
+        capacity += (instr.opcode == OP_DOTW ? 256 : 64) + 16 + 16;
+    }
+    return capacity;
+}
+
+size_t DLXJITX64::generateEntry(const DLXLazyNativeProgram& program) {
+    writePrologue(lazyLiveOnEntry);
+    writeJump(0);
+    dlxOffsetsInRawCode[lazyInstructions.size()] = rawCode.size();
+    auto exitOffset = writeEpilogue();
+    writeResolveTrampoline(program);
+    auto blockStart = rawCode.size();
+    writeBlock(program, 0);
+    linkBlock();
+    program.writeCode(0, rawCode.data(), rawCode.size());
+    DLXPerfMap& perfMap = DLXPerfMap::instance();
+    const uint8_t* code = (const uint8_t*)program.getCode();
+    perfMap.add(code, exitOffset, "dlx:entry");
+    perfMap.add(code + exitOffset, resolveTrampolineOffset - exitOffset, "dlx:exit");
+    perfMap.add(code + resolveTrampolineOffset, blockStart - resolveTrampolineOffset, "dlx:resolve");
+    addBlockToPerfMap(program, blockStart, 0);
+    return exitOffset;
+}
+
+size_t DLXJITX64::generateBlock(const DLXLazyNativeProgram& program, uint32_t position) {
+    //another thread may have been waiting for the same block
+    if (!isDLXInstructionCompiled(position))
+    {
+        auto start = rawCode.size();
+        writeBlock(program, position);
+        linkBlock();
+        program.writeCode(start, &rawCode[start], rawCode.size() - start);
+        addBlockToPerfMap(program, start, position);
+    }
+    auto branches = branchesToStubs.equal_range(position);
+    for (auto branch = branches.first; branch != branches.second; ++branch)
+    {
+        int32_t offset = calcBranchOffset(position, branch->second);
+        memcpy(&rawCode[branch->second], &offset, sizeof(offset));
+        program.writeCode(branch->second, &offset, sizeof(offset));
+    }
+    branchesToStubs.erase(branches.first, branches.second);
+    return dlxOffsetsInRawCode[position];
+}
+
+void DLXJITX64::addBlockToPerfMap(const DLXLazyNativeProgram& program, size_t start, InstructionCollection::size_type position) {
+    //the block goes on with the stubs of its successors
+    string name = position < sourcePositions.size() ? getCodeName(sourcePositions[position]) : "dlx:exit";
+    DLXPerfMap::instance().add((const uint8_t*)program.getCode() + start, rawCode.size() - start, name);
+}
+
+void DLXJITX64::writeResolveTrampoline(const DLXLazyNativeProgram& program) {
+    //entered from a stub that pushed the position of the block
+    resolveTrampolineOffset = rawCode.size();
+    for (auto reg : callerSavedRegisters)
+        writePush(reg);
+    writePush(RBP);
+    writeMov(true, RBP, RSP);
+    int32_t positionOffset = 8 + numberOfCallerSavedRegisters * 8;
+    writeLoad(RSI, RBP, NO_INDEX_REGISTER, positionOffset);
+    writeMovabs(RDI, (uint64_t)&program);
+    writeAnd(true, RSP, -16);
+    writeMovabs(RAX, (uint64_t)&DLXLazyNativeProgram::resolve);
+    writeCall(RAX);
+    writeMov(true, RSP, RBP);
+    writePop(RBP);
+    //the position is replaced by the address of the block, ret jumps there
+    writeStore(true, RAX, RSP, NO_INDEX_REGISTER, positionOffset - 8);
+    for (int i = numberOfCallerSavedRegisters - 1; i >= 0; i--)
+        writePop(callerSavedRegisters[i]);
+    writeRet();
+}
+
+void DLXJITX64::writeBlock(const DLXLazyNativeProgram& program, InstructionCollection::size_type position) {
+    predicatedInstructionsLeft = 0;
+    auto i = position;
+    do
+    {
+        const auto& instr = lazyInstructions[i];
+        dlxOffsetsInRawCode[i] = rawCode.size();
+        program.addSourceAddress(rawCode.size(), codContent[sourcePositions[i]].iaddr);
+        if (countedPositions[sourcePositions[i]])
+            writeCountExecution(sourcePositions[i]);
+        if (predicatedInstructionsLeft > 0)
+        {
+            compilePredicatedInstruction(instr, predicateCondition);
+            predicatedInstructionsLeft--;
+        }
+        else
+        {
+            compileDLXInstruction(instr);
+        }
+        i++;
+    } while (!blockStarts[i] || predicatedInstructionsLeft > 0);
+
+    //BRLE/BRGE R0 always jumps, others continue with the next block
+    const auto& last = lazyInstructions[i - 1];
+    if (!(isBranch(last) && last.rs1 == 0 && (last.opcode == OP_BRLE || last.opcode == OP_BRGE)))
+        writeJump(i);
+}
+
+void DLXJITX64::linkBlock() {
+    for (auto& toRepair : jumpOffsetsToRepair)
+    {
+        auto target = toRepair.targetDlx;
+        if (!isDLXInstructionCompiled(target))
+        {
+            if (stubOffsets[target] == 0)
+            {
+                stubOffsets[target] = rawCode.size();
+                writePush((int32_t)target);
+                writeJmp(resolveTrampolineOffset - (rawCode.size() + 5));
+            }
+            branchesToStubs.insert({ target, toRepair.branchOffsetPosition });
+            int32_t offset = stubOffsets[target] - (toRepair.branchOffsetPosition + sizeof(int32_t));
+            memcpy(&rawCode[toRepair.branchOffsetPosition], &offset, sizeof(offset));
+        }
+        else
+        {
+            int32_t offset = calcBranchOffset(target, toRepair.branchOffsetPosition);
+            memcpy(&rawCode[toRepair.branchOffsetPosition], &offset, sizeof(offset));
+        }
+    }
+    jumpOffsetsToRepair.clear();
+}
+
+shared_ptr<const DLXCompiledProgram> DLXJITX64::compile() {
+    const DLXDataMemory& dataMemory = context.getDataMemory();
+    byteSwapData = dataMemory.isByteSwapNeeded();
+    if (lazyCompilation)
+    {
+        //the program owns a generator of its own, this instance may compile again or go away
+        unique_ptr<DLXJITX64> generator(new DLXJITX64(*this));
+        size_t capacity = generator->prepareLazyCode();
+        return make_shared<DLXLazyNativeProgram>(dataMemory.getByteOrder(), getDataMemoryFootprint(), getNumberOfCounters(), capacity, move(generator));
+    }
+    //everything the generated code depends on besides the program
+    string options = string("x64") + (byteSwapData ? " byteswap" : "") +
+        (__builtin_cpu_supports("sse4.1") ? " sse4.1" : "") + " unroll=" + to_string(loopUnrollFactor) +
+        (finalRegistersKept ? " keepregs" : "") + (entryPosition > 0 ? " entry=" + to_string(entryPosition) : "") +
+        (executionCounting == COUNT_BLOCKS ? " count=blocks" : executionCounting == COUNT_INSTRUCTIONS ? " count=instructions" : "");
+    DLXCodeCache cache(codeCacheDirectory, instructions, options);
+    size_t footprint;
+    if (cache.load(rawCode, dlxOffsetsInRawCode, sourcePositions, footprint))
+        setDataMemoryFootprint(footprint);
+    else
+    {
+        generateCode();
+        cache.store(rawCode, dlxOffsetsInRawCode, sourcePositions, getDataMemoryFootprint());
+    }
+
+    DLXNativeProgram::SourceAddresses sourceAddresses;
+    sourceAddresses.reserve(sourcePositions.size());
+    for (InstructionCollection::size_type i = 0; i < sourcePositions.size(); i++)
+        sourceAddresses.push_back({ dlxOffsetsInRawCode[i], codContent[sourcePositions[i]].iaddr });
+    auto program = make_shared<DLXNativeProgram>(dataMemory.getByteOrder(), getDataMemoryFootprint(), getNumberOfCounters(),
+        rawCode.data(), rawCode.size(), move(sourceAddresses));
+    addToPerfMap((const uint8_t*)program->getCode(), rawCode.size(), dlxOffsetsInRawCode, sourcePositions);
+
+#if defined(DLXJIT_PRINT_LISTING)
+    {
+        cerr << "Compiled program size: " << rawCode.size() << " bytes" << "\r\n";
+        for (InstructionCollection::size_type i = 0; i < sourcePositions.size(); i++)
+        {
+                auto position = sourcePositions[i];
+                cerr << (codContent[position].label == "" ? "" : codContent[position].label+":") << "\t" << instructionToString(position) << ":\t0x" << std::hex << (((unsigned long)program->getCode()) + dlxOffsetsInRawCode[i]) << "\r\n";
+        }
+        cerr << std::dec;
+    }
+#endif
+    return program;
+}
+
+
+
+DLXJITX64::~DLXJITX64() {
+}
+
+#endif
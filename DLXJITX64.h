@@ -0,0 +1,199 @@
+/*
+ * File:   DLXJITX64.h
+ *
+ * x86-64 (System V ABI) counterpart of DLXJITArm7.
+ */
+#pragma once
+#if defined(__x86_64__)
+#include "DLXJIT.h"
+#include "DLXCompiledProgram.h"
+#include <map>
+#include <vector>
+#include <initializer_list>
+
+enum Register
+{
+    RAX = 0x0,
+    RCX = 0x1,
+    RDX = 0x2,
+    RBX = 0x3,
+    RSP = 0x4,
+    RBP = 0x5,
+    RSI = 0x6,
+    RDI = 0x7,
+    R8 = 0x8,
+    R9 = 0x9,
+    R10 = 0xa,
+    R11 = 0xb,
+    R12 = 0xc,
+    R13 = 0xd,
+    R14 = 0xe,
+    R15 = 0xf
+};
+
+enum Condition
+{
+    CC_O = 0x0,
+    CC_NO = 0x1,
+    CC_B = 0x2,
+    CC_AE = 0x3,
+    CC_E = 0x4,
+    CC_NE = 0x5,
+    CC_BE = 0x6,
+    CC_A = 0x7,
+    CC_S = 0x8,
+    CC_NS = 0x9,
+    CC_P = 0xa,
+    CC_NP = 0xb,
+    CC_L = 0xc,
+    CC_GE = 0xd,
+    CC_LE = 0xe,
+    CC_G = 0xf
+};
+
+class DLXJITX64 : public DLXJIT, public DLXLazyNativeProgram::Generator {
+public:
+    typedef std::vector<char> RawCodeContainer;
+
+    DLXJITX64();
+
+    ~DLXJITX64() override;
+private:
+    void writeRex(bool wide, Register reg, Register index, Register base);
+    void writeModRM(uint8_t mod, uint8_t reg, uint8_t rm);
+    void writeMemoryOperand(Register reg, Register base, Register index, int32_t displacement);
+    void writeRegisterInstruction(uint8_t opcode, bool wide, Register reg, Register rm);
+
+    void writeNop();
+    void writeMov(Register dest, Register src);
+    void writeMov(bool wide, Register dest, Register src);
+    void writeMov(Register dest, int32_t imm);
+
+    void writeAdd(Register dest, Register src);
+    void writeAdd(bool wide, Register dest, Register src);
+    void writeAdd(bool wide, Register dest, int32_t imm);
+    void writeSub(Register dest, Register src);
+    void writeSub(bool wide, Register dest, Register src);
+    void writeXor(Register dest, Register src);
+    void writeSub(bool wide, Register dest, int32_t imm);
+    //adds 1 to the 64 bit word at base + displacement
+    void writeIncrement(Register base, int32_t displacement);
+    void writeAnd(bool wide, Register dest, int32_t imm);
+    void writeNeg(Register dest);
+    void writeImul(Register dest, Register src);
+    void writeBswap(Register dest);
+    void writeTest(Register src1, Register src2);
+    void writeCmp(Register src1, Register src2);
+    void writeCmov(Condition cond, Register dest, Register src);
+    void writeSar(Register dest, uint8_t shift);
+    //32 bit result of base + index + displacement, flags are not changed
+    void writeLea(Register dest, Register base, Register index, int32_t displacement);
+    void writeMovabs(Register dest, uint64_t imm);
+    //SSE instruction with an xmm register in ModRM.reg and rm as register or as [rm]
+    void writeSimdInstruction(uint8_t prefix, std::initializer_list<uint8_t> opcode, bool wide, int xmm, Register rm, bool memoryOperand);
+
+    void writeLoad(Register dst, Register base, Register index, int32_t offset);
+    void writeLoad(bool wide, Register dst, Register base, Register index, int32_t offset);
+    void writeStore(Register src, Register base, Register index, int32_t offset);
+    void writeStore(bool wide, Register src, Register base, Register index, int32_t offset);
+
+    void writePush(Register src);
+    void writePush(int32_t imm);
+    void writePop(Register dst);
+    void writeCall(Register target);
+    void writeRet();
+    void writeJcc(Condition cond, int32_t offset);
+    void writeJmp(int32_t offset);
+
+    bool isDLXRegisterMapped(int no);
+    Register getMappedRegister(int no);
+    Register loadDLXRegister(int no, int argumentNumber);
+    //index register holding the DLX address no + offset, offset becomes the displacement still to add
+    Register getAddressRegister(int no, int32_t& offset, Register scratch);
+
+    Register getRegisterForTargetDLXRegister(int no);
+    void storeTargetDLXRegister(int no);
+
+    int32_t calcBranchOffset(InstructionCollection::size_type targetDlx, RawCodeContainer::size_type branchOffsetPosition);
+    bool isDLXInstructionCompiled(InstructionCollection::size_type position);
+
+    void alignBranchOffset(RawCodeContainer::size_type opcodeSize, InstructionCollection::size_type targetDlx);
+    void writeBranch(Condition cond, InstructionCollection::size_type targetDlx);
+    void writeJump(InstructionCollection::size_type targetDlx);
+    //jumps when cond holds, or predicates the instructions the branch skips after if-conversion
+    void writeConditionalBranch(Condition cond, const DLXInstruction& branch);
+
+    void compileDLXInstruction(const DLXInstruction& instr);
+    //instruction skipped by an if-converted branch, rd is written only when cond holds
+    void compilePredicatedInstruction(const DLXInstruction& instr, Condition cond);
+    //SSE4.1 body of OP_DOTW, 4 iterations at once
+    void writeDotProduct(const DLXInstruction& instr);
+    //dest = limit - pointer
+    void writeLimitDistance(Register dest, Register pointer, int32_t limit);
+
+    //registers from the context at the start of the program
+    void writeLoadDLXRegisters(uint32_t registers);
+    //all registers back to the context, when final values are kept
+    void writeStoreDLXRegisters();
+    int getRegistersPointerOffsetOnStack();
+    int getExecutionCountsPointerOffsetOnStack();
+    int32_t getFrameSize();
+    void writeCountExecution(InstructionCollection::size_type position);
+    void repairBranchOffsets();
+
+    //optimizes the program and maps DLX registers to host registers, returns the registers live on entry
+    uint32_t prepareCode(InstructionCollection& optimized);
+    void writePrologue(uint32_t liveOnEntry);
+    //returns the code offset of the part that leaves without storing the registers
+    RawCodeContainer::size_type writeEpilogue();
+    //fills rawCode, dlxOffsetsInRawCode and sourcePositions
+    void generateCode();
+
+    //lazy compilation, rawCode mirrors the code of the program and grows by one block at a time
+    //prepares generateEntry, returns the executable memory the program needs at most
+    std::size_t prepareLazyCode();
+    std::size_t generateEntry(const DLXLazyNativeProgram& program) override;
+    std::size_t generateBlock(const DLXLazyNativeProgram& program, uint32_t position) override;
+    //saves the registers the generated code keeps in caller saved host registers and calls resolve
+    void writeResolveTrampoline(const DLXLazyNativeProgram& program);
+    //names the code from start to the end of rawCode after the block at position
+    void addBlockToPerfMap(const DLXLazyNativeProgram& program, std::size_t start, InstructionCollection::size_type position);
+    //appends the instructions from position to the next block start
+    void writeBlock(const DLXLazyNativeProgram& program, InstructionCollection::size_type position);
+    //branches of the last block to blocks that do not exist yet lead to their stubs instead
+    void linkBlock();
+    //generated or cached code is mapped into executable memory
+    std::shared_ptr<const DLXCompiledProgram> compile() override;
+    RawCodeContainer rawCode;
+    //code offset of every optimized instruction, followed by the offset of the epilogue
+    std::vector<RawCodeContainer::size_type> dlxOffsetsInRawCode;
+    SourcePositions sourcePositions;
+    //position in allocatableRegisters for every DLX register, or DLXRegisterAllocator::SPILLED
+    std::vector<int> dlxRegisterAllocation;
+    //false when data memory is kept in host byte order
+    bool byteSwapData;
+    //instructions left to compile with compilePredicatedInstruction
+    unsigned predicatedInstructionsLeft;
+    Condition predicateCondition;
+    //getCountedPositions of the program being compiled
+    std::vector<bool> countedPositions;
+
+    struct JumpOffsetToRepair
+    {
+            InstructionCollection::size_type targetDlx;
+            RawCodeContainer::size_type branchOffsetPosition;
+    };
+
+    std::vector<JumpOffsetToRepair> jumpOffsetsToRepair;
+
+    InstructionCollection lazyInstructions;
+    uint32_t lazyLiveOnEntry;
+    //first instructions of basic blocks, the end of the program included
+    std::vector<bool> blockStarts;
+    //code offset of the stub that has the block at a position generated, 0 when there is none
+    std::vector<RawCodeContainer::size_type> stubOffsets;
+    //position of a block that does not exist yet -> offsets of the branches to it
+    std::multimap<InstructionCollection::size_type, RawCodeContainer::size_type> branchesToStubs;
+    RawCodeContainer::size_type resolveTrampolineOffset;
+};
+#endif
@@ -0,0 +1,136 @@
+#include "DLXLivenessAnalysis.h"
+
+using namespace std;
+
+inline DLXLivenessAnalysis::RegisterSet registerBit(int no)
+{
+	return no == 0 ? 0 : (DLXLivenessAnalysis::RegisterSet)1 << no;
+}
+
+DLXLivenessAnalysis::RegisterSet DLXLivenessAnalysis::getUsedRegisters(const DLXInstruction& instr)
+{
+	switch (instr.opcode)
+	{
+	case OP_ADD:
+	case OP_STW:
+	case OP_COPYW:
+		return registerBit(instr.rs1) | registerBit(instr.rs2);
+	case OP_MULADD:
+	case OP_DOTW:
+		return registerBit(instr.rs1) | registerBit(instr.rs2) | registerBit(instr.rd);
+	case OP_ADDI:
+	case OP_SUBI:
+	case OP_LOOPCHECK:
+	case OP_LDW:
+	case OP_BRLE:
+	case OP_BRGE:
+	case OP_MOV:
+	case OP_LOOPCHECK_BRLE:
+	case OP_LOOPCHECK_BRGE:
+		return registerBit(instr.rs1);
+	default:
+		return 0;
+	}
+}
+
+DLXLivenessAnalysis::RegisterSet DLXLivenessAnalysis::getDefinedRegisters(const DLXInstruction& instr)
+{
+	switch (instr.opcode)
+	{
+	case OP_ADD:
+	case OP_ADDI:
+	case OP_SUBI:
+	case OP_MULADD:
+	case OP_LOOPCHECK:
+	case OP_LDW:
+	case OP_LI:
+	case OP_MOV:
+	case OP_COPYW:
+	case OP_LOOPCHECK_BRLE:
+	case OP_LOOPCHECK_BRGE:
+		return registerBit(instr.rd);
+	case OP_DOTW:
+		return registerBit(instr.rs1) | registerBit(instr.rs2) | registerBit(instr.rd);
+	default:
+		return 0;
+	}
+}
+
+DLXLivenessAnalysis::DLXLivenessAnalysis(const vector<DLXInstruction>& instructions, RegisterSet liveOnExit)
+	: liveBefore(instructions.size()), liveAfter(instructions.size())
+{
+	size_t count = instructions.size();
+
+	//basic blocks start at branch targets and after branches
+	vector<bool> leader(count + 1, false);
+	leader[0] = true;
+	leader[count] = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (isBranch(instructions[i]))
+		{
+			leader[i + 1] = true;
+			if (instructions[i].target < count)
+				leader[instructions[i].target] = true;
+		}
+	}
+
+	vector<size_t> blockStart;
+	vector<size_t> blockOfInstruction(count);
+	for (size_t i = 0; i <= count; i++)
+	{
+		if (leader[i])
+			blockStart.push_back(i);
+		if (i < count)
+			blockOfInstruction[i] = blockStart.size() - 1;
+	}
+	size_t numberOfBlocks = blockStart.size() - 1;
+
+	vector<RegisterSet> blockUse(numberOfBlocks, 0);
+	vector<RegisterSet> blockDef(numberOfBlocks, 0);
+	for (size_t b = 0; b < numberOfBlocks; b++)
+	{
+		for (size_t i = blockStart[b]; i < blockStart[b + 1]; i++)
+		{
+			blockUse[b] |= getUsedRegisters(instructions[i]) & ~blockDef[b];
+			blockDef[b] |= getDefinedRegisters(instructions[i]);
+		}
+	}
+
+	//all branches are conditional, so every block may fall through
+	vector<RegisterSet> blockLiveIn(numberOfBlocks + 1, 0);
+	blockLiveIn[numberOfBlocks] = liveOnExit & ~(RegisterSet)1;
+	vector<RegisterSet> blockLiveOut(numberOfBlocks, 0);
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (size_t b = numberOfBlocks; b-- > 0;)
+		{
+			RegisterSet out = blockLiveIn[b + 1];
+			const DLXInstruction& last = instructions[blockStart[b + 1] - 1];
+			if (isBranch(last) && last.target < count)
+				out |= blockLiveIn[blockOfInstruction[last.target]];
+			else if (isBranch(last))
+				out |= blockLiveIn[numberOfBlocks];
+			RegisterSet in = blockUse[b] | (out & ~blockDef[b]);
+			if (in != blockLiveIn[b] || out != blockLiveOut[b])
+			{
+				blockLiveIn[b] = in;
+				blockLiveOut[b] = out;
+				changed = true;
+			}
+		}
+	}
+
+	for (size_t b = 0; b < numberOfBlocks; b++)
+	{
+		RegisterSet live = blockLiveOut[b];
+		for (size_t i = blockStart[b + 1]; i-- > blockStart[b];)
+		{
+			liveAfter[i] = live;
+			live = (live & ~getDefinedRegisters(instructions[i])) | getUsedRegisters(instructions[i]);
+			liveBefore[i] = live;
+		}
+	}
+}
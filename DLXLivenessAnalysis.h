@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "DLXInstruction.h"
+
+//Liveness of DLX registers over the instruction vector, solved per basic block
+//and then expanded to every instruction. Sets hold one bit per register,
+//R0 is hardwired to zero and never live.
+class DLXLivenessAnalysis
+{
+public:
+	typedef uint32_t RegisterSet;
+
+	//liveOnExit: registers read after the program ends, none by default
+	explicit DLXLivenessAnalysis(const std::vector<DLXInstruction>& instructions, RegisterSet liveOnExit = 0);
+
+	static RegisterSet getUsedRegisters(const DLXInstruction& instr);
+	static RegisterSet getDefinedRegisters(const DLXInstruction& instr);
+
+	//registers that may be read before being written, starting at the instruction
+	RegisterSet getLiveBefore(std::size_t position) const { return liveBefore[position]; }
+	//registers that may be read before being written, starting after the instruction
+	RegisterSet getLiveAfter(std::size_t position) const { return liveAfter[position]; }
+	//registers whose initial value is observed by the program
+	RegisterSet getLiveOnEntry() const { return liveBefore.empty() ? 0 : liveBefore[0]; }
+private:
+	std::vector<RegisterSet> liveBefore;
+	std::vector<RegisterSet> liveAfter;
+};
@@ -0,0 +1,199 @@
+#include "DLXLoopIdiomRecognizer.h"
+#include <algorithm>
+
+using namespace std;
+
+typedef uint32_t RegisterSet;
+
+//used for pointers that do not limit the loop
+static const int32_t noLimit = INT16_MAX;
+
+struct DotProductLoop
+{
+	size_t header;
+	DLXInstruction dotw;
+};
+
+static bool fitsInHalf(int32_t value)
+{
+	return value >= INT16_MIN && value <= INT16_MAX;
+}
+
+//skips NOPs, returns end if nothing else is left before it
+static size_t nextInstruction(const vector<DLXInstruction>& instructions, size_t position, size_t end)
+{
+	while (position < end && instructions[position].opcode == OP_NOP)
+		position++;
+	return position;
+}
+
+//ADDI r, 4, r optionally followed by a wrap of r, position is moved past them
+static bool matchIncrement(const vector<DLXInstruction>& instructions, size_t& position, size_t latch, uint8_t pointer, RegisterSet dotwRegisters, int32_t& limit)
+{
+	const DLXInstruction& increment = instructions[position];
+	bool isIncrement = increment.rs1 == pointer && increment.rd == pointer &&
+		((increment.opcode == OP_ADDI && increment.imm == 4) || (increment.opcode == OP_SUBI && increment.imm == -4));
+	if (!isIncrement)
+		return false;
+	position = nextInstruction(instructions, position + 1, latch);
+
+	const DLXInstruction& check = instructions[position];
+	if (position == latch || check.opcode != OP_LOOPCHECK_BRGE || check.rs1 != pointer)
+		return true;
+	size_t reset = nextInstruction(instructions, position + 1, latch);
+	if (reset == latch || instructions[reset].opcode != OP_LI || instructions[reset].rd != pointer)
+		return false;
+	size_t afterReset = nextInstruction(instructions, reset + 1, latch);
+	if (check.target <= reset || nextInstruction(instructions, check.target, latch) != afterReset || (dotwRegisters & 1u << check.rd) || !fitsInHalf(check.imm))
+		return false;
+	limit = min(limit, check.imm);
+	position = afterReset;
+	return true;
+}
+
+//enteredFromOutside holds the instructions from the loop header to the latch
+static bool findDotProductLoop(const vector<DLXInstruction>& instructions, const vector<bool>& enteredFromOutside, size_t latch, DotProductLoop& loop)
+{
+	const DLXInstruction& check = instructions[latch];
+	size_t header = check.target;
+	size_t position = nextInstruction(instructions, header, latch);
+	if (latch - position < 4)
+		return false;
+	for (size_t i = header + 1; i <= latch; i++)
+	{
+		if (enteredFromOutside[i - header])
+			return false;
+	}
+
+	const DLXInstruction& loadA = instructions[position];
+	size_t loadBPosition = nextInstruction(instructions, position + 1, latch);
+	const DLXInstruction& loadB = instructions[loadBPosition];
+	size_t mulPosition = nextInstruction(instructions, loadBPosition + 1, latch);
+	const DLXInstruction& mul = instructions[mulPosition];
+	if (loadA.opcode != OP_LDW || loadB.opcode != OP_LDW || mul.opcode != OP_MULADD)
+		return false;
+	uint8_t a = loadA.rd, b = loadB.rd, p = loadA.rs1, q = loadB.rs1, acc = mul.rd;
+	if (a == 0 || b == 0 || p == 0 || q == 0 || acc == 0 || !fitsInHalf(loadA.imm) || !fitsInHalf(loadB.imm))
+		return false;
+	if (!((mul.rs1 == a && mul.rs2 == b) || (mul.rs1 == b && mul.rs2 == a)))
+		return false;
+	//only the two pointers may be the same register
+	uint8_t registers[] = { a, b, acc, p, q };
+	for (size_t i = 0; i < 5; i++)
+	{
+		for (size_t j = i + 1; j < 5; j++)
+		{
+			if (registers[i] == registers[j] && !(i == 3 && j == 4))
+				return false;
+		}
+	}
+	//registers read by DOTW, results of the loop checks must not overwrite them
+	RegisterSet dotwRegisters = 1u << p | 1u << q | 1u << acc;
+
+	int32_t limitP = noLimit, limitQ = noLimit;
+	position = nextInstruction(instructions, mulPosition + 1, latch);
+	if (position == latch)
+		return false;
+	if (instructions[position].rs1 == p)
+	{
+		if (!matchIncrement(instructions, position, latch, p, dotwRegisters, limitP))
+			return false;
+		if (q != p && (position == latch || !matchIncrement(instructions, position, latch, q, dotwRegisters, limitQ)))
+			return false;
+	}
+	else
+	{
+		if (!matchIncrement(instructions, position, latch, q, dotwRegisters, limitQ))
+			return false;
+		if (q != p && (position == latch || !matchIncrement(instructions, position, latch, p, dotwRegisters, limitP)))
+			return false;
+	}
+	if (nextInstruction(instructions, position, latch) != latch)
+		return false;
+
+	if ((check.rs1 != p && check.rs1 != q) || !fitsInHalf(check.imm))
+		return false;
+	if (dotwRegisters & 1u << check.rd)
+		return false;
+	if (check.rs1 == p)
+		limitP = min(limitP, check.imm);
+	if (check.rs1 == q)
+		limitQ = min(limitQ, check.imm);
+	if (p == q)
+		limitP = limitQ = min(limitP, limitQ);
+
+	DLXInstruction dotw = { OP_DOTW, p, q, acc, packHalves(loadA.imm, loadB.imm), 0 };
+	dotw.imm2 = packHalves(limitP, limitQ);
+	loop.header = header;
+	loop.dotw = dotw;
+	return true;
+}
+
+void DLXLoopIdiomRecognizer::recognize(vector<DLXInstruction>& instructions, vector<size_t>& sourcePositions)
+{
+	size_t count = instructions.size();
+
+	//branches are found once, each loop only looks at those to its own body
+	vector<vector<size_t>> branchesTo(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (isBranch(instructions[i]) && instructions[i].target < count)
+			branchesTo[instructions[i].target].push_back(i);
+	}
+
+	vector<DotProductLoop> loops;
+	for (size_t latch = 0; latch < count; latch++)
+	{
+		const DLXInstruction& check = instructions[latch];
+		if (check.opcode != OP_LOOPCHECK_BRGE || check.target > latch)
+			continue;
+		vector<bool> enteredFromOutside(latch - check.target + 1, false);
+		for (size_t i = check.target; i <= latch; i++)
+		{
+			for (size_t from : branchesTo[i])
+				enteredFromOutside[i - check.target] = enteredFromOutside[i - check.target] || from < check.target || from > latch;
+		}
+		DotProductLoop loop;
+		if (findDotProductLoop(instructions, enteredFromOutside, latch, loop))
+			loops.push_back(loop);
+	}
+	if (loops.empty())
+		return;
+
+	//branches to a loop header reach its DOTW, including the loop's own latch
+	vector<size_t> newPositions(count + 1);
+	size_t inserted = 0;
+	auto loop = loops.begin();
+	for (size_t i = 0; i <= count; i++)
+	{
+		newPositions[i] = i + inserted;
+		if (loop != loops.end() && i == loop->header)
+		{
+			inserted++;
+			++loop;
+		}
+	}
+
+	vector<DLXInstruction> result;
+	vector<size_t> resultSources;
+	result.reserve(count + inserted);
+	resultSources.reserve(count + inserted);
+	loop = loops.begin();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (loop != loops.end() && i == loop->header)
+		{
+			result.push_back(loop->dotw);
+			resultSources.push_back(sourcePositions[i]);
+			++loop;
+		}
+		DLXInstruction instr = instructions[i];
+		if (isBranch(instr))
+			instr.target = newPositions[instr.target];
+		result.push_back(instr);
+		resultSources.push_back(sourcePositions[i]);
+	}
+
+	instructions.swap(result);
+	sourcePositions.swap(resultSources);
+}
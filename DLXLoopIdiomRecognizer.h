@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include "DLXInstruction.h"
+
+//Finds innermost loops that compute a dot product of two word streams
+//  H:  LDW a, offA(p)
+//      LDW b, offB(q)
+//      MULADD a, b, acc
+//      ADDI p, 4, p  [LOOPCHECK_BRGE p, wrapLimit, t -> K; LI p, start; K:]
+//      ADDI q, 4, q  [same wrap of q]
+//      LOOPCHECK_BRGE p or q, limit, t -> H
+//and puts an OP_DOTW in front of the loop body, so engines can run the
+//iterations before the loop exit or a wrap of p or q in bulk. The loop
+//itself stays and runs at least one iteration after every DOTW.
+class DLXLoopIdiomRecognizer
+{
+public:
+	//sourcePositions is updated, inserted instructions get the position of the loop header
+	static void recognize(std::vector<DLXInstruction>& instructions, std::vector<std::size_t>& sourcePositions);
+};
@@ -0,0 +1,205 @@
+#include "DLXLoopUnroller.h"
+#include "DLXLivenessAnalysis.h"
+
+using namespace std;
+
+//unrolled loops larger than this are left alone
+static const size_t maxUnrolledLength = 256;
+
+struct CountedLoop
+{
+	size_t header;
+	size_t latch;
+	int32_t step;
+};
+
+inline DLXInstruction makeInstruction(DLXOpcode opcode, uint8_t rs1, uint8_t rs2, uint8_t rd, int32_t imm)
+{
+	DLXInstruction instr = { opcode, rs1, rs2, rd, imm, 0 };
+	return instr;
+}
+
+//step of the only write to the induction register, 0 if it is not ADDI i, step, i
+//executed once in every iteration
+static int32_t findStep(const vector<DLXInstruction>& instructions, size_t header, size_t latch, uint8_t induction)
+{
+	DLXLivenessAnalysis::RegisterSet inductionBit = (DLXLivenessAnalysis::RegisterSet)1 << induction;
+	int32_t step = 0;
+	size_t increment = 0;
+	for (size_t i = header; i < latch; i++)
+	{
+		const DLXInstruction& instr = instructions[i];
+		if (!(DLXLivenessAnalysis::getDefinedRegisters(instr) & inductionBit))
+			continue;
+		if (step != 0 || instr.rs1 != induction)
+			return 0;
+		if (instr.opcode == OP_ADDI)
+			step = instr.imm;
+		else if (instr.opcode == OP_SUBI)
+			step = -instr.imm;
+		if (step <= 0)
+			return 0;
+		increment = i;
+	}
+	if (step == 0)
+		return 0;
+	//a forward branch must not skip the increment
+	for (size_t i = header; i < increment; i++)
+	{
+		if (isBranch(instructions[i]) && instructions[i].target > increment)
+			return 0;
+	}
+	return step;
+}
+
+//enteredFromOutside holds the instructions from the loop header to the latch
+static bool findCountedLoop(const vector<DLXInstruction>& instructions, const vector<bool>& enteredFromOutside, size_t latch, unsigned factor, CountedLoop& loop)
+{
+	const DLXInstruction& check = instructions[latch];
+	if (check.opcode != OP_LOOPCHECK_BRGE || check.target > latch || check.rd == check.rs1 || check.rs1 == 0)
+		return false;
+	size_t header = check.target;
+	if ((latch - header + 1) * (factor + 1) + 2 > maxUnrolledLength)
+		return false;
+	for (size_t i = header; i < latch; i++)
+	{
+		//loops that are already run in bulk are left alone
+		if (instructions[i].opcode == OP_DOTW)
+			return false;
+		//innermost loops only, control leaves through the latch
+		if (isBranch(instructions[i]) && (instructions[i].target <= i || instructions[i].target > latch))
+			return false;
+		if (i > header && enteredFromOutside[i - header])
+			return false;
+	}
+	if (enteredFromOutside[latch - header])
+		return false;
+	int32_t step = findStep(instructions, header, latch, check.rs1);
+	if (step == 0)
+		return false;
+	//guard immediate has to fit as well
+	int64_t guard = (int64_t)check.imm - (int64_t)(factor - 1) * step + 1;
+	if (guard < INT32_MIN || guard > INT32_MAX)
+		return false;
+	loop.header = header;
+	loop.latch = latch;
+	loop.step = step;
+	return true;
+}
+
+void DLXLoopUnroller::unroll(vector<DLXInstruction>& instructions, vector<size_t>& sourcePositions, unsigned factor)
+{
+	if (factor < 2)
+		return;
+	size_t count = instructions.size();
+
+	//branch targets reached by a branch outside of the loop they belong to are found per loop
+	vector<vector<size_t>> branchesTo(count + 1);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (isBranch(instructions[i]) && instructions[i].target <= count)
+			branchesTo[instructions[i].target].push_back(i);
+	}
+
+	vector<CountedLoop> loops;
+	for (size_t latch = 0; latch < count; latch++)
+	{
+		const DLXInstruction& check = instructions[latch];
+		if (check.opcode != OP_LOOPCHECK_BRGE || check.target > latch)
+			continue;
+		//only the loop body, a program of many loops is not scanned once per loop
+		vector<bool> enteredFromOutside(latch - check.target + 1, false);
+		for (size_t i = check.target; i <= latch; i++)
+		{
+			for (size_t from : branchesTo[i])
+				enteredFromOutside[i - check.target] = enteredFromOutside[i - check.target] || from < check.target || from > latch;
+		}
+		CountedLoop loop;
+		//accepted loops contain no other backward branch, so they never overlap
+		if (findCountedLoop(instructions, enteredFromOutside, latch, factor, loop))
+			loops.push_back(loop);
+	}
+	if (loops.empty())
+		return;
+
+	//positions of the original instructions that stay outside of unrolled loops, headers map to the guard
+	vector<size_t> newPositions(count + 1);
+	size_t position = 0;
+	auto loop = loops.begin();
+	for (size_t i = 0; i < count; i++)
+	{
+		newPositions[i] = position;
+		if (loop != loops.end() && i == loop->header)
+		{
+			size_t length = loop->latch - loop->header + 1;
+			position += 1 + length * factor + 1 + length;
+			i = loop->latch;
+			++loop;
+			continue;
+		}
+		position++;
+	}
+	newPositions[count] = position;
+
+	vector<DLXInstruction> unrolled;
+	vector<size_t> unrolledSources;
+	unrolled.reserve(position);
+	unrolledSources.reserve(position);
+	//copy of header..latch starting at base, branches stay inside the copy
+	auto appendBody = [&](const CountedLoop& l, bool keepLatchBranch) {
+		size_t base = unrolled.size();
+		for (size_t i = l.header; i <= l.latch; i++)
+		{
+			DLXInstruction instr = instructions[i];
+			if (i == l.latch && !keepLatchBranch)
+				instr = makeInstruction(instr.rd == 0 ? OP_NOP : OP_LOOPCHECK, instr.rs1, 0, instr.rd, instr.imm);
+			else if (isBranch(instr))
+				instr.target = base + (instr.target - l.header);
+			unrolled.push_back(instr);
+			unrolledSources.push_back(sourcePositions[i]);
+		}
+	};
+
+	loop = loops.begin();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (loop == loops.end() || i != loop->header)
+		{
+			DLXInstruction instr = instructions[i];
+			if (isBranch(instr))
+				instr.target = newPositions[instr.target];
+			unrolled.push_back(instr);
+			unrolledSources.push_back(sourcePositions[i]);
+			continue;
+		}
+
+		const DLXInstruction& check = instructions[loop->latch];
+		size_t length = loop->latch - loop->header + 1;
+		size_t guardPosition = unrolled.size();
+		size_t remainderPosition = guardPosition + 1 + length * factor + 1;
+
+		//limit - i < (factor - 1) * step  <=>  limit - (factor - 1) * step + 1 - i <= 0
+		DLXInstruction guard = makeInstruction(OP_LOOPCHECK_BRLE, check.rs1, 0, 0, check.imm - (int32_t)(factor - 1) * loop->step + 1);
+		guard.target = remainderPosition;
+		unrolled.push_back(guard);
+		unrolledSources.push_back(sourcePositions[loop->header]);
+
+		for (unsigned copy = 0; copy < factor; copy++)
+			appendBody(*loop, copy == factor - 1);
+		unrolled.back().target = guardPosition;
+
+		//R0 is always 0, so the exit path jumps over the remainder loop
+		DLXInstruction exit = makeInstruction(OP_BRGE, 0, 0, 0, 0);
+		exit.target = newPositions[loop->latch + 1];
+		unrolled.push_back(exit);
+		unrolledSources.push_back(sourcePositions[loop->latch]);
+
+		appendBody(*loop, true);
+
+		i = loop->latch;
+		++loop;
+	}
+
+	instructions.swap(unrolled);
+	sourcePositions.swap(unrolledSources);
+}
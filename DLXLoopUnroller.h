@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include "DLXInstruction.h"
+
+//Unrolls innermost counted loops of the form
+//  H:  body, advances i exactly once with ADDI i, step, i (step > 0)
+//      LOOPCHECK_BRGE i, limit, t -> H
+//into
+//  H:  LOOPCHECK_BRLE i, limit - (factor - 1) * step + 1 -> R    fewer than factor iterations left
+//      body x factor, only the last copy branches back to H
+//      BRGE R0 -> E
+//  R:  H..latch as it was, remainder iterations
+//  E:
+//The induction register is assumed not to wrap around.
+class DLXLoopUnroller
+{
+public:
+	//sourcePositions is updated, so every instruction keeps the position it was copied from
+	static void unroll(std::vector<DLXInstruction>& instructions, std::vector<std::size_t>& sourcePositions, unsigned factor);
+};
@@ -0,0 +1,609 @@
+#include "DLXMemoryFootprintAnalysis.h"
+#include "DLXLivenessAnalysis.h"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+
+using namespace std;
+
+static const int numberOfRegisters = 32;
+//bounds outside of the 32 bit range, standing for no bound
+static const int64_t unbounded = (int64_t)1 << 40;
+//changes of a loop header state before growing bounds of registers written in the loop are given up
+static const unsigned changesBeforeWidening = 3;
+//changes before the bounds of all registers are given up, when the loops are not nested in order
+static const unsigned changesBeforeWideningAll = changesBeforeWidening + 32;
+//passes that tighten the bounds again after widening
+static const unsigned maxNarrowingPasses = 8;
+//programs whose relations keep changing after that many visits of a block are not analysed
+static const unsigned maxVisits = 1000;
+
+struct Interval
+{
+	int64_t low;
+	int64_t high;
+};
+
+static const Interval top = { -unbounded, unbounded };
+
+static Interval makeInterval(int64_t low, int64_t high)
+{
+	if (low > INT32_MAX || high < INT32_MIN)
+		return top;
+	Interval interval = { low < INT32_MIN ? -unbounded : low, high > INT32_MAX ? unbounded : high };
+	return interval;
+}
+
+static Interval add(Interval a, Interval b)
+{
+	return makeInterval(a.low + b.low, a.high + b.high);
+}
+
+//value - a
+static Interval subtractFrom(int64_t value, Interval a)
+{
+	return makeInterval(value - a.high, value - a.low);
+}
+
+static Interval multiply(Interval a, Interval b)
+{
+	if (a.low == -unbounded || a.high == unbounded || b.low == -unbounded || b.high == unbounded)
+		return top;
+	int64_t products[] = { a.low * b.low, a.low * b.high, a.high * b.low, a.high * b.high };
+	return makeInterval(*min_element(products, products + 4), *max_element(products, products + 4));
+}
+
+//false when no value is left
+static bool refine(Interval& interval, int64_t low, int64_t high)
+{
+	interval.low = max(interval.low, low);
+	interval.high = min(interval.high, high);
+	return interval.low <= interval.high;
+}
+
+//value of a register; after LOOPCHECK it is also known as limit - checkedRegister,
+//a register advanced in step with another one is known as relatedRegister + offset
+struct RegisterValue
+{
+	Interval interval;
+	int checkedRegister;
+	int32_t limit;
+	int relatedRegister;
+	int64_t offset;
+};
+
+struct State
+{
+	bool reachable;
+	RegisterValue registers[numberOfRegisters];
+};
+
+//bounds of the register itself and of the register it is related to
+static Interval valueOf(const State& state, int no)
+{
+	const RegisterValue& value = state.registers[no];
+	Interval interval = value.interval;
+	if (value.relatedRegister >= 0)
+	{
+		Interval related = add(state.registers[value.relatedRegister].interval, makeInterval(value.offset, value.offset));
+		Interval both = interval;
+		if (refine(both, related.low, related.high))
+			interval = both;
+	}
+	return interval;
+}
+
+static void define(State& state, int no, Interval interval)
+{
+	if (no == 0)
+		return;
+	RegisterValue value = { interval, -1, 0, -1, 0 };
+	state.registers[no] = value;
+	for (auto& other : state.registers)
+	{
+		if (other.checkedRegister == no)
+			other.checkedRegister = -1;
+		if (other.relatedRegister == no)
+			other.relatedRegister = -1;
+	}
+}
+
+//no = source + offset
+static void defineOffset(State& state, int no, int source, int64_t offset)
+{
+	if (no == 0)
+		return;
+	Interval interval = add(valueOf(state, source), makeInterval(offset, offset));
+	if (no != source)
+	{
+		define(state, no, interval);
+		if (source != 0)
+		{
+			state.registers[no].relatedRegister = source;
+			state.registers[no].offset = offset;
+		}
+		return;
+	}
+	//registers related to this one keep their relation with the new value
+	RegisterValue& value = state.registers[no];
+	value.interval = interval;
+	value.checkedRegister = -1;
+	value.offset += offset;
+	for (auto& other : state.registers)
+	{
+		if (other.checkedRegister == no)
+			other.checkedRegister = -1;
+		if (other.relatedRegister == no)
+			other.offset -= offset;
+	}
+}
+
+static void defineCheck(State& state, int no, int checkedRegister, int32_t limit)
+{
+	define(state, no, subtractFrom(limit, valueOf(state, checkedRegister)));
+	if (no != 0 && no != checkedRegister)
+	{
+		state.registers[no].checkedRegister = checkedRegister;
+		state.registers[no].limit = limit;
+	}
+}
+
+//the register is known to be in [low, high], so is limit - register for the register it was checked against
+static bool refineRegister(State& state, int no, int64_t low, int64_t high)
+{
+	RegisterValue& value = state.registers[no];
+	if (!refine(value.interval, low, high))
+		return false;
+	if (value.checkedRegister < 0)
+		return true;
+	Interval checked = subtractFrom(value.limit, value.interval);
+	return refine(state.registers[value.checkedRegister].interval, checked.low, checked.high);
+}
+
+//state on the taken or the fall through edge of a branch, false when the edge is never used
+static bool refineBranch(State& state, const DLXInstruction& instr, bool taken)
+{
+	bool lessOrEqual = instr.opcode == OP_BRLE || instr.opcode == OP_LOOPCHECK_BRLE;
+	int64_t low, high;
+	if (taken == lessOrEqual)
+	{
+		low = -unbounded;
+		high = taken ? 0 : -1;
+	}
+	else
+	{
+		low = taken ? 0 : 1;
+		high = unbounded;
+	}
+	if (instr.opcode == OP_BRLE || instr.opcode == OP_BRGE)
+		return refineRegister(state, instr.rs1, low, high);
+	if (instr.rd != 0)
+		return refineRegister(state, instr.rd, low, high);
+	//the LOOPCHECK result is discarded, the condition still holds for imm - rs1
+	Interval checked = subtractFrom(instr.imm, makeInterval(low, high));
+	return refine(state.registers[instr.rs1].interval, checked.low, checked.high);
+}
+
+//no - other, when it is known in the state
+static bool getDifference(const State& state, int no, int other, int64_t& difference)
+{
+	const RegisterValue& a = state.registers[no];
+	const RegisterValue& b = state.registers[other];
+	if (a.relatedRegister == other)
+		difference = a.offset;
+	else if (b.relatedRegister == no)
+		difference = -b.offset;
+	else if (a.relatedRegister >= 0 && a.relatedRegister == b.relatedRegister)
+		difference = a.offset - b.offset;
+	else if (a.interval.low == a.interval.high && b.interval.low == b.interval.high)
+		difference = a.interval.low - b.interval.low;
+	else
+		return false;
+	return true;
+}
+
+//growing bounds of the widened registers jump to the next of the sorted thresholds,
+//or become unbounded past the last one; true when into changed
+static bool join(State& into, const State& from, DLXLivenessAnalysis::RegisterSet widened, const vector<int64_t>& thresholds)
+{
+	if (!from.reachable)
+		return false;
+	if (!into.reachable)
+	{
+		into = from;
+		return true;
+	}
+	//registers with the same difference in both states become related, like pointers
+	//advanced in step; found before the intervals change. Without a relation of its own,
+	//a register has a difference only to the registers related to it and, when it is
+	//constant, to the other constants, so only those are tried.
+	DLXLivenessAnalysis::RegisterSet relatedTo[numberOfRegisters] = {};
+	DLXLivenessAnalysis::RegisterSet constants = 0;
+	for (int no = 1; no < numberOfRegisters; no++)
+	{
+		const RegisterValue& value = into.registers[no];
+		if (value.relatedRegister >= 0)
+			relatedTo[value.relatedRegister] |= (DLXLivenessAnalysis::RegisterSet)1 << no;
+		if (value.interval.low == value.interval.high)
+			constants |= (DLXLivenessAnalysis::RegisterSet)1 << no;
+	}
+	int related[numberOfRegisters];
+	int64_t offsets[numberOfRegisters];
+	for (int no = 1; no < numberOfRegisters; no++)
+	{
+		related[no] = -1;
+		const RegisterValue& value = into.registers[no];
+		if (value.relatedRegister >= 0)
+			continue;
+		DLXLivenessAnalysis::RegisterSet candidates = relatedTo[no];
+		if (value.interval.low == value.interval.high)
+			candidates |= constants;
+		candidates &= ~((DLXLivenessAnalysis::RegisterSet)1 << no | 1);
+		for (; candidates != 0 && related[no] < 0; candidates &= candidates - 1)
+		{
+			int other = __builtin_ctz(candidates);
+			int64_t difference, otherDifference;
+			if (getDifference(into, no, other, difference) && getDifference(from, no, other, otherDifference) &&
+				difference == otherDifference)
+			{
+				related[no] = other;
+				offsets[no] = difference;
+			}
+		}
+	}
+
+	bool changed = false;
+	for (int no = 0; no < numberOfRegisters; no++)
+	{
+		RegisterValue& value = into.registers[no];
+		const RegisterValue& other = from.registers[no];
+		Interval joined = { min(value.interval.low, other.interval.low), max(value.interval.high, other.interval.high) };
+		bool widen = (widened >> no & 1) != 0;
+		if (widen && joined.low < value.interval.low)
+		{
+			auto threshold = upper_bound(thresholds.begin(), thresholds.end(), joined.low);
+			joined.low = threshold == thresholds.begin() ? -unbounded : *(threshold - 1);
+		}
+		if (widen && joined.high > value.interval.high)
+		{
+			auto threshold = lower_bound(thresholds.begin(), thresholds.end(), joined.high);
+			joined.high = threshold == thresholds.end() ? unbounded : *threshold;
+		}
+		if (joined.low != value.interval.low || joined.high != value.interval.high)
+		{
+			value.interval = joined;
+			changed = true;
+		}
+		if (value.checkedRegister >= 0 && (value.checkedRegister != other.checkedRegister || value.limit != other.limit))
+		{
+			value.checkedRegister = -1;
+			changed = true;
+		}
+		int64_t difference;
+		if (value.relatedRegister >= 0 && !(getDifference(from, no, value.relatedRegister, difference) && difference == value.offset))
+		{
+			value.relatedRegister = -1;
+			changed = true;
+		}
+	}
+	//a relation more is not a change, the intervals and the remaining relations decide when to stop
+	for (int no = 1; no < numberOfRegisters; no++)
+	{
+		if (related[no] >= 0)
+		{
+			into.registers[no].relatedRegister = related[no];
+			into.registers[no].offset = offsets[no];
+		}
+	}
+	return changed;
+}
+
+static bool isSame(const State& a, const State& b)
+{
+	if (a.reachable != b.reachable)
+		return false;
+	for (int no = 0; a.reachable && no < numberOfRegisters; no++)
+	{
+		const RegisterValue& x = a.registers[no];
+		const RegisterValue& y = b.registers[no];
+		if (x.interval.low != y.interval.low || x.interval.high != y.interval.high ||
+			x.checkedRegister != y.checkedRegister || (x.checkedRegister >= 0 && x.limit != y.limit) ||
+			x.relatedRegister != y.relatedRegister || (x.relatedRegister >= 0 && x.offset != y.offset))
+			return false;
+	}
+	return true;
+}
+
+class FootprintSolver
+{
+public:
+	FootprintSolver(const vector<DLXInstruction>& instructions)
+		: instructions(instructions), bounded(true), size(0)
+	{
+		findBlocks();
+	}
+
+	void solve()
+	{
+		size_t numberOfBlocks = blockStart.size() - 1;
+		if (numberOfBlocks == 0)
+			return;
+		State entry;
+		entry.reachable = true;
+		for (auto& value : entry.registers)
+			value = RegisterValue{ top, -1, 0, -1, 0 };
+		entry.registers[0].interval = makeInterval(0, 0);
+
+		//growing bounds at loop headers are widened, so every loop settles; registers
+		//only written outside of a loop are widened by the outer loop, if at all.
+		//Loop conditions compare against 0 or the limit of a LOOPCHECK, those are
+		//the bounds induction registers are widened to first.
+		vector<State> in(numberOfBlocks + 1);
+		for (auto& state : in)
+			state.reachable = false;
+		in[0] = entry;
+		vector<unsigned> changes(numberOfBlocks + 1, 0);
+		vector<unsigned> visits(numberOfBlocks, 0);
+		//the earliest block in reverse postorder first, so inner loops settle before
+		//the code after them is visited; only successors of changed states are queued
+		set<size_t> queued;
+		queued.insert(0);
+		while (!queued.empty())
+		{
+			size_t b = order[*queued.begin()];
+			queued.erase(queued.begin());
+			if (++visits[b] == maxVisits)
+			{
+				bounded = false;
+				return;
+			}
+			forEachSuccessor(b, in[b], false, [&](size_t successor, const State& state) {
+				DLXLivenessAnalysis::RegisterSet widened = 0;
+				if (changes[successor] >= changesBeforeWideningAll)
+					widened = ~(DLXLivenessAnalysis::RegisterSet)0;
+				else if (changes[successor] >= changesBeforeWidening)
+					widened = writtenInLoop[successor];
+				if (join(in[successor], state, widened, thresholds))
+				{
+					changes[successor]++;
+					if (successor < numberOfBlocks)
+						queued.insert(orderOfBlock[successor]);
+				}
+			});
+		}
+
+		//loop exits bound the widened registers again
+		for (unsigned pass = 0; pass < maxNarrowingPasses; pass++)
+		{
+			vector<State> narrowed(numberOfBlocks + 1);
+			for (auto& state : narrowed)
+				state.reachable = false;
+			narrowed[0] = entry;
+			for (size_t b = 0; b < numberOfBlocks; b++)
+			{
+				forEachSuccessor(b, in[b], false, [&](size_t successor, const State& state) {
+					join(narrowed[successor], state, 0, thresholds);
+				});
+			}
+			bool same = true;
+			for (size_t b = 0; b < numberOfBlocks && same; b++)
+				same = isSame(narrowed[b], in[b]);
+			in.swap(narrowed);
+			if (same)
+				break;
+		}
+
+		for (size_t b = 0; b < numberOfBlocks; b++)
+			forEachSuccessor(b, in[b], true, [](size_t, const State&) {});
+	}
+
+	bool isBounded() const { return bounded; }
+	size_t getSize() const { return size; }
+private:
+	//basic blocks start at branch targets and after branches, as in DLXLivenessAnalysis
+	void findBlocks()
+	{
+		size_t count = instructions.size();
+		vector<bool> leader(count + 1, false);
+		leader[0] = true;
+		leader[count] = true;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (isBranch(instructions[i]) || instructions[i].opcode == OP_HALT)
+				leader[i + 1] = true;
+			if (isBranch(instructions[i]) && instructions[i].target < count)
+				leader[instructions[i].target] = true;
+		}
+		blockOfInstruction.resize(count + 1);
+		for (size_t i = 0; i <= count; i++)
+		{
+			if (leader[i])
+				blockStart.push_back(i);
+			blockOfInstruction[i] = blockStart.size() - 1;
+		}
+		findOrder();
+
+		thresholds.push_back(-1);
+		thresholds.push_back(0);
+		for (const auto& instr : instructions)
+		{
+			if (instr.opcode == OP_LOOPCHECK || instr.opcode == OP_LOOPCHECK_BRLE || instr.opcode == OP_LOOPCHECK_BRGE)
+			{
+				thresholds.push_back(instr.imm);
+				thresholds.push_back((int64_t)instr.imm + 1);
+			}
+		}
+		sort(thresholds.begin(), thresholds.end());
+		thresholds.erase(unique(thresholds.begin(), thresholds.end()), thresholds.end());
+
+		writtenInLoop.assign(blockStart.size(), 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!isBranch(instructions[i]) || instructions[i].target > i)
+				continue;
+			auto& written = writtenInLoop[blockOfInstruction[instructions[i].target]];
+			for (size_t j = instructions[i].target; j <= i; j++)
+				written |= DLXLivenessAnalysis::getDefinedRegisters(instructions[j]);
+		}
+	}
+
+	//blocks reachable from the entry in reverse postorder
+	void findOrder()
+	{
+		size_t numberOfBlocks = blockStart.size() - 1;
+		orderOfBlock.assign(numberOfBlocks, numberOfBlocks);
+		if (numberOfBlocks == 0)
+			return;
+		vector<bool> visited(numberOfBlocks, false);
+		vector<size_t> postorder;
+		//block and the number of its successors pushed so far
+		vector<pair<size_t, unsigned>> path;
+		path.push_back({ 0, 0 });
+		visited[0] = true;
+		while (!path.empty())
+		{
+			size_t block = path.back().first;
+			size_t successors[2];
+			unsigned count = getSuccessors(block, successors);
+			if (path.back().second == count)
+			{
+				postorder.push_back(block);
+				path.pop_back();
+				continue;
+			}
+			size_t successor = successors[path.back().second++];
+			if (successor < numberOfBlocks && !visited[successor])
+			{
+				visited[successor] = true;
+				path.push_back({ successor, 0 });
+			}
+		}
+		order.assign(postorder.rbegin(), postorder.rend());
+		for (size_t i = 0; i < order.size(); i++)
+			orderOfBlock[order[i]] = i;
+	}
+
+	//as forEachSuccessor, without the states
+	unsigned getSuccessors(size_t block, size_t* successors) const
+	{
+		const DLXInstruction& last = instructions[blockStart[block + 1] - 1];
+		if (last.opcode == OP_HALT)
+			return 0;
+		unsigned count = 0;
+		if (isBranch(last))
+			successors[count++] = blockOfInstruction[min<size_t>(last.target, instructions.size())];
+		successors[count++] = block + 1;
+		return count;
+	}
+
+	void recordAccess(Interval base, int32_t offset)
+	{
+		Interval address = add(base, makeInterval(offset, offset));
+		if (address.low < 0 || address.high == unbounded)
+			bounded = false;
+		else
+			size = max(size, (size_t)address.high + 4);
+	}
+
+	void transfer(State& state, const DLXInstruction& instr, bool record)
+	{
+		switch (instr.opcode)
+		{
+		case OP_ADD:
+			if (instr.rs1 == 0 || instr.rs2 == 0)
+				defineOffset(state, instr.rd, instr.rs1 | instr.rs2, 0);
+			else
+				define(state, instr.rd, add(valueOf(state, instr.rs1), valueOf(state, instr.rs2)));
+			break;
+		case OP_ADDI:
+			defineOffset(state, instr.rd, instr.rs1, instr.imm);
+			break;
+		case OP_SUBI:
+			defineOffset(state, instr.rd, instr.rs1, -(int64_t)instr.imm);
+			break;
+		case OP_MULADD:
+			define(state, instr.rd, add(valueOf(state, instr.rd), multiply(valueOf(state, instr.rs1), valueOf(state, instr.rs2))));
+			break;
+		case OP_LOOPCHECK:
+		case OP_LOOPCHECK_BRLE:
+		case OP_LOOPCHECK_BRGE:
+			defineCheck(state, instr.rd, instr.rs1, instr.imm);
+			break;
+		case OP_LDW:
+			if (record)
+				recordAccess(valueOf(state, instr.rs1), instr.imm);
+			define(state, instr.rd, top);
+			break;
+		case OP_STW:
+			if (record)
+				recordAccess(valueOf(state, instr.rs1), instr.imm);
+			break;
+		case OP_LI:
+			define(state, instr.rd, makeInterval(instr.imm, instr.imm));
+			break;
+		case OP_MOV:
+			defineOffset(state, instr.rd, instr.rs1, 0);
+			break;
+		case OP_COPYW:
+			if (record)
+			{
+				recordAccess(valueOf(state, instr.rs1), instr.imm);
+				recordAccess(valueOf(state, instr.rs2), instr.imm2);
+			}
+			define(state, instr.rd, top);
+			break;
+		case OP_DOTW:
+			//runs an unknown number of iterations
+			if (record)
+				bounded = false;
+			define(state, instr.rd, top);
+			define(state, instr.rs1, top);
+			define(state, instr.rs2, top);
+			break;
+		default:
+			break;
+		}
+	}
+
+	template<typename Visitor>
+	void forEachSuccessor(size_t block, const State& in, bool record, Visitor visit)
+	{
+		if (!in.reachable)
+			return;
+		State out = in;
+		for (size_t i = blockStart[block]; i < blockStart[block + 1]; i++)
+			transfer(out, instructions[i], record);
+		const DLXInstruction& last = instructions[blockStart[block + 1] - 1];
+		if (last.opcode == OP_HALT)
+			return;
+		if (isBranch(last))
+		{
+			State taken = out;
+			if (refineBranch(taken, last, true))
+				visit(blockOfInstruction[min<size_t>(last.target, instructions.size())], taken);
+			if (!refineBranch(out, last, false))
+				return;
+		}
+		visit(block + 1, out);
+	}
+
+	const vector<DLXInstruction>& instructions;
+	vector<size_t> blockStart;
+	vector<size_t> blockOfInstruction;
+	//blocks in reverse postorder and the position of every block in it, numberOfBlocks for unreachable ones
+	vector<size_t> order;
+	vector<size_t> orderOfBlock;
+	//registers written between a loop header and its backward branches, 0 for other blocks
+	vector<DLXLivenessAnalysis::RegisterSet> writtenInLoop;
+	vector<int64_t> thresholds;
+	bool bounded;
+	size_t size;
+};
+
+DLXMemoryFootprintAnalysis::DLXMemoryFootprintAnalysis(const vector<DLXInstruction>& instructions)
+{
+	FootprintSolver solver(instructions);
+	solver.solve();
+	bounded = solver.isBounded();
+	size = solver.getSize();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "DLXInstruction.h"
+
+//Range of data addresses the loads and stores of a program may touch, found
+//by interval analysis of register values over the basic blocks. Loop
+//induction registers are bounded by the BRLE/BRGE conditions on their
+//LOOPCHECK results. Registers read before they are written and loaded words
+//are unknown. Like DLXLoopUnroller, registers are assumed not to wrap around.
+class DLXMemoryFootprintAnalysis
+{
+public:
+	explicit DLXMemoryFootprintAnalysis(const std::vector<DLXInstruction>& instructions);
+
+	//false when an address depends on unknown values
+	bool isBounded() const { return bounded; }
+	//one past the highest byte accessed, 0 when not bounded
+	std::size_t getSize() const { return bounded ? size : 0; }
+private:
+	bool bounded;
+	std::size_t size;
+};
@@ -0,0 +1,131 @@
+#include "DLXMemoryImage.h"
+#include <endian.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DLXJITException.h"
+#include "DLXOutputFile.h"
+
+using namespace std;
+
+static const char magic[4] = { 'D', 'L', 'X', 'M' };
+static const uint32_t version = 1;
+
+enum DLXImageWordOrder
+{
+	IMAGE_BIG_ENDIAN = 0,
+	IMAGE_LITTLE_ENDIAN = 1
+};
+
+struct DLXImageHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t wordOrder;
+	uint32_t base;
+	uint64_t dataOffset;
+	uint64_t size;
+}__attribute__((__packed__));
+
+const char* const DLXMemoryImage::extension = ".dlxm";
+
+//layout of the bytes of memory in that order
+static DLXImageWordOrder getWordOrder(DLXDataByteOrder order)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	return order == DATA_HOST_ENDIAN ? IMAGE_LITTLE_ENDIAN : IMAGE_BIG_ENDIAN;
+#else
+	return IMAGE_BIG_ENDIAN;
+#endif
+}
+
+bool DLXMemoryImage::isImage(const string& fileName)
+{
+	char start[sizeof(magic)];
+	ifstream file(fileName, ios::in | ios::binary);
+	return file.read(start, sizeof(start)) && memcmp(start, magic, sizeof(magic)) == 0;
+}
+
+bool DLXMemoryImage::isImageName(const string& fileName)
+{
+	size_t length = strlen(extension);
+	return fileName.size() > length && fileName.compare(fileName.size() - length, length, extension) == 0;
+}
+
+void DLXMemoryImage::load(const string& fileName, DLXDataMemory& memory, bool shared)
+{
+	int file = open(fileName.c_str(), shared ? O_RDWR : O_RDONLY);
+	if (file < 0)
+		throw DLXJITException("Unable to open " + fileName + ": " + strerror(errno));
+	try
+	{
+		DLXImageHeader header;
+		struct stat status;
+		if (pread(file, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || fstat(file, &status) != 0 ||
+			memcmp(header.magic, magic, sizeof(magic)) != 0)
+			throw DLXJITException("Invalid memory image " + fileName);
+		uint64_t dataOffset = le64toh(header.dataOffset);
+		uint64_t size = le64toh(header.size);
+		if (le32toh(header.version) != version || le32toh(header.base) != 0 || dataOffset < sizeof(header) ||
+			dataOffset + size > (uint64_t)status.st_size)
+			throw DLXJITException("Invalid memory image " + fileName);
+
+		DLXDataByteOrder order = memory.getByteOrder();
+		DLXDataByteOrder imageOrder;
+		switch (le32toh(header.wordOrder))
+		{
+		case IMAGE_BIG_ENDIAN:
+			imageOrder = DATA_BIG_ENDIAN;
+			break;
+		case IMAGE_LITTLE_ENDIAN:
+			if (getWordOrder(DATA_HOST_ENDIAN) != IMAGE_LITTLE_ENDIAN)
+				throw DLXJITException("Little endian memory images are not supported on this host");
+			imageOrder = DATA_HOST_ENDIAN;
+			break;
+		default:
+			throw DLXJITException("Invalid memory image " + fileName);
+		}
+		if (shared && getWordOrder(imageOrder) != getWordOrder(order))
+			throw DLXJITException("Memory image " + fileName + " has another byte order and can not be shared");
+
+		if (size == 0)
+		{
+			memory = DLXDataMemory();
+			memory.setByteOrder(order);
+		}
+		else
+		{
+			memory.mapFile(file, dataOffset, size, imageOrder, shared);
+			//converted on the heap when the orders differ
+			memory.setByteOrder(order);
+		}
+	}
+	catch (...)
+	{
+		close(file);
+		throw;
+	}
+	close(file);
+}
+
+void DLXMemoryImage::save(const string& fileName, DLXDataMemory& memory)
+{
+	char header[headerSize] = {};
+	DLXImageHeader fields;
+	memcpy(fields.magic, magic, sizeof(magic));
+	fields.version = htole32(version);
+	fields.wordOrder = htole32(getWordOrder(memory.getByteOrder()));
+	fields.base = 0;
+	fields.dataOffset = htole64(headerSize);
+	fields.size = htole64(memory.size());
+	memcpy(header, &fields, sizeof(fields));
+
+	//memory may still be mapped from fileName
+	DLXOutputFile file(fileName);
+	file.write(header, sizeof(header));
+	file.write(memory.data(), memory.size());
+	file.commit();
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "DLXDataMemory.h"
+
+//Binary data memory image: a header page followed by the raw bytes of
+//data memory, so it can be mapped instead of parsed. Header fields are
+//little endian:
+//  "DLXM", uint32 version, uint32 word order (0 big, 1 little endian),
+//  uint32 base (DLX address of the first byte, 0), uint64 offset of the
+//  bytes in the file, uint64 number of bytes
+class DLXMemoryImage
+{
+public:
+	static const std::size_t headerSize = 4096;
+	//file name extension of images written by DLXJIT::saveDataFile
+	static const char* const extension;
+
+	//true when the file starts with the image magic
+	static bool isImage(const std::string& fileName);
+	//true when the name ends with extension
+	static bool isImageName(const std::string& fileName);
+
+	//contents are mapped copy-on-write, or shared so that changes go straight
+	//to the file. Memory keeps its byte order; an image in the other order is
+	//converted on the heap and can not be shared.
+	static void load(const std::string& fileName, DLXDataMemory& memory, bool shared = false);
+	//image in the byte order of memory
+	static void save(const std::string& fileName, DLXDataMemory& memory);
+};
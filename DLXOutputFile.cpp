@@ -0,0 +1,121 @@
+#include "DLXOutputFile.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DLXJITException.h"
+
+using namespace std;
+
+static bool isOpenAs(int descriptor, const struct stat& status)
+{
+	struct stat openStatus;
+	return fstat(descriptor, &openStatus) == 0 && openStatus.st_dev == status.st_dev && openStatus.st_ino == status.st_ino;
+}
+
+DLXOutputFile::DLXOutputFile(const string& fileName)
+	: fileName(fileName), file(-1)
+{
+	struct stat status;
+	bool exists = stat(fileName.c_str(), &status) == 0;
+	//stdout or stderr (/dev/stdout) continue at their position, what else the process prints follows
+	for (int descriptor : { STDOUT_FILENO, STDERR_FILENO })
+	{
+		if (exists && isOpenAs(descriptor, status))
+		{
+			file = fcntl(descriptor, F_DUPFD_CLOEXEC, 0);
+			if (file < 0)
+				throw DLXJITException("Unable to create " + fileName + ": " + strerror(errno));
+			return;
+		}
+	}
+	//only a regular file can be mapped by a load that is still running, anything else
+	//(a new file, a device, a pipe) is written directly
+	char* realName = exists && S_ISREG(status.st_mode) ? realpath(fileName.c_str(), nullptr) : nullptr;
+	if (realName == nullptr)
+	{
+		file = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (file < 0)
+			throw DLXJITException("Unable to create " + fileName + ": " + strerror(errno));
+		return;
+	}
+	//a symbolic link keeps pointing to the replaced file
+	targetName = realName;
+	free(realName);
+
+	//batch jobs of one process save at the same time
+	static atomic<unsigned> counter(0);
+	do
+	{
+		temporaryName = targetName + "." + to_string(getpid()) + "." + to_string(counter++) + ".tmp";
+		file = open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	} while (file < 0 && errno == EEXIST);
+	if (file < 0)
+		throw DLXJITException("Unable to create " + fileName + ": " + strerror(errno));
+	//the replacement keeps owner and mode; the owner can only be kept where we are allowed to
+	//change it, otherwise the file stays ours. chown clears set-user-ID bits, so the mode comes last
+	int ownerKept = fchown(file, status.st_uid, status.st_gid);
+	(void)ownerKept;
+	if (fchmod(file, status.st_mode & 07777) != 0)
+	{
+		int error = errno;
+		close(file);
+		file = -1;
+		unlink(temporaryName.c_str());
+		throw DLXJITException("Unable to create " + fileName + ": " + strerror(error));
+	}
+}
+
+DLXOutputFile::~DLXOutputFile()
+{
+	if (file >= 0)
+	{
+		close(file);
+		if (!temporaryName.empty())
+			unlink(temporaryName.c_str());
+	}
+}
+
+void DLXOutputFile::write(const void* data, size_t size)
+{
+	const char* next = (const char*)data;
+	while (size > 0)
+	{
+		ssize_t written = ::write(file, next, size);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			throw DLXJITException("Unable to write " + fileName + ": " + strerror(errno));
+		next += written;
+		size -= written;
+	}
+}
+
+void DLXOutputFile::commit()
+{
+	int result = close(file);
+	file = -1;
+	if (temporaryName.empty())
+	{
+		if (result != 0)
+			throw DLXJITException("Unable to write " + fileName + ": " + strerror(errno));
+		return;
+	}
+	if (result != 0 || rename(temporaryName.c_str(), targetName.c_str()) != 0)
+	{
+		int error = errno;
+		unlink(temporaryName.c_str());
+		throw DLXJITException("Unable to write " + fileName + ": " + strerror(error));
+	}
+}
+
+bool DLXOutputFile::isSameFile(const string& fileName, const string& otherFileName)
+{
+	struct stat status, otherStatus;
+	return stat(fileName.c_str(), &status) == 0 && stat(otherFileName.c_str(), &otherStatus) == 0 &&
+		status.st_dev == otherStatus.st_dev && status.st_ino == otherStatus.st_ino;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+//File that replaces fileName only once it is completely written. When fileName
+//is an existing regular file, the contents go to a temporary file next to it
+//that commit renames over it, so the old file stays intact for whoever still
+//maps or reads it, including data memory loaded from it. The replacement keeps
+//the mode and, where allowed, the owner; symbolic links are followed, so the
+//file they point to is replaced. New files and anything that is not a regular
+//file are written directly; the file stdout or stderr goes to (/dev/stdout) is
+//written through that descriptor, at its current position.
+class DLXOutputFile
+{
+public:
+	//throws DLXJITException when the file can not be created
+	explicit DLXOutputFile(const std::string& fileName);
+	//removes a temporary file unless commit succeeded
+	~DLXOutputFile();
+
+	void write(const void* data, std::size_t size);
+	//closes the file and renames a temporary file over the target
+	void commit();
+
+	//true when both names refer to the same existing file, whatever their spelling
+	static bool isSameFile(const std::string& fileName, const std::string& otherFileName);
+private:
+	DLXOutputFile(const DLXOutputFile&) = delete;
+	DLXOutputFile& operator=(const DLXOutputFile&) = delete;
+
+	std::string fileName;
+	//fileName with symbolic links resolved, empty when written directly
+	std::string targetName;
+	std::string temporaryName;
+	int file;
+};
@@ -0,0 +1,149 @@
+#include "DLXPeepholeOptimizer.h"
+#include "DLXLivenessAnalysis.h"
+
+using namespace std;
+
+static const size_t maxWindowLength = 2;
+
+struct PeepholeRule
+{
+	size_t length;
+	DLXOpcode window[maxWindowLength];
+	bool (*matches)(const DLXInstruction* window);
+	DLXInstruction (*rewrite)(const DLXInstruction* window);
+};
+
+inline DLXInstruction makeInstruction(DLXOpcode opcode, uint8_t rs1, uint8_t rs2, uint8_t rd, int32_t imm)
+{
+	DLXInstruction instr = { opcode, rs1, rs2, rd, imm, 0 };
+	return instr;
+}
+
+//rules are tried in order at every position, first match wins
+static const PeepholeRule rules[] = {
+	//ADDI R0, imm, Rx -> Rx = imm
+	{ 1, { OP_ADDI },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[0].rs1 == 0; },
+		[](const DLXInstruction* w) { return makeInstruction(OP_LI, 0, 0, w[0].rd, w[0].imm); } },
+	//SUBI R0, imm, Rx -> Rx = -imm
+	{ 1, { OP_SUBI },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[0].rs1 == 0; },
+		[](const DLXInstruction* w) { return makeInstruction(OP_LI, 0, 0, w[0].rd, -w[0].imm); } },
+	//ADDI/SUBI Ry, 0, Rx -> Rx = Ry
+	{ 1, { OP_ADDI },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[0].imm == 0; },
+		[](const DLXInstruction* w) { return makeInstruction(OP_MOV, w[0].rs1, 0, w[0].rd, 0); } },
+	{ 1, { OP_SUBI },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[0].imm == 0; },
+		[](const DLXInstruction* w) { return makeInstruction(OP_MOV, w[0].rs1, 0, w[0].rd, 0); } },
+	//ADD Ry, R0, Rx or ADD R0, Ry, Rx -> Rx = Ry
+	{ 1, { OP_ADD },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && (w[0].rs1 == 0 || w[0].rs2 == 0); },
+		[](const DLXInstruction* w) {
+			uint8_t source = w[0].rs1 == 0 ? w[0].rs2 : w[0].rs1;
+			return source == 0 ? makeInstruction(OP_LI, 0, 0, w[0].rd, 0) : makeInstruction(OP_MOV, source, 0, w[0].rd, 0);
+		} },
+	//LDW Rx, a(Ry); STW Rx, b(Rz) -> word copied without converting it twice
+	{ 2, { OP_LDW, OP_STW },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[1].rs2 == w[0].rd && w[1].rs1 != w[0].rd; },
+		[](const DLXInstruction* w) {
+			DLXInstruction instr = makeInstruction(OP_COPYW, w[0].rs1, w[1].rs1, w[0].rd, w[0].imm);
+			instr.imm2 = w[1].imm;
+			return instr;
+		} },
+	//LOOPCHECK Ry, imm, Rx; BRGE/BRLE Rx, target -> flags of the subtraction are branched on
+	{ 2, { OP_LOOPCHECK, OP_BRGE },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[1].rs1 == w[0].rd; },
+		[](const DLXInstruction* w) {
+			DLXInstruction instr = makeInstruction(OP_LOOPCHECK_BRGE, w[0].rs1, 0, w[0].rd, w[0].imm);
+			instr.target = w[1].target;
+			return instr;
+		} },
+	{ 2, { OP_LOOPCHECK, OP_BRLE },
+		[](const DLXInstruction* w) { return w[0].rd != 0 && w[1].rs1 == w[0].rd; },
+		[](const DLXInstruction* w) {
+			DLXInstruction instr = makeInstruction(OP_LOOPCHECK_BRLE, w[0].rs1, 0, w[0].rd, w[0].imm);
+			instr.target = w[1].target;
+			return instr;
+		} },
+	//MOV Rx, Rx does nothing
+	{ 1, { OP_MOV },
+		[](const DLXInstruction* w) { return w[0].rs1 == w[0].rd; },
+		[](const DLXInstruction*) { return makeInstruction(OP_NOP, 0, 0, 0, 0); } },
+};
+
+static bool matchesWindow(const PeepholeRule& rule, const vector<DLXInstruction>& instructions, const vector<bool>& branchTarget, size_t position)
+{
+	if (position + rule.length > instructions.size())
+		return false;
+	for (size_t k = 0; k < rule.length; k++)
+	{
+		if (instructions[position + k].opcode != rule.window[k])
+			return false;
+		//control may enter only at the first instruction of the window
+		if (k > 0 && branchTarget[position + k])
+			return false;
+	}
+	return rule.matches(&instructions[position]);
+}
+
+void DLXPeepholeOptimizer::optimize(vector<DLXInstruction>& instructions, uint32_t liveOnExit)
+{
+	applyRules(instructions);
+	discardDeadResults(instructions, liveOnExit);
+}
+
+void DLXPeepholeOptimizer::applyRules(vector<DLXInstruction>& instructions)
+{
+	vector<bool> branchTarget(instructions.size(), false);
+	for (const auto& instr : instructions)
+	{
+		if (isBranch(instr) && instr.target < instructions.size())
+			branchTarget[instr.target] = true;
+	}
+
+	const DLXInstruction nop = makeInstruction(OP_NOP, 0, 0, 0, 0);
+	for (size_t i = 0; i < instructions.size(); i++)
+	{
+		//later rules in the table see the rewritten instruction
+		for (const auto& rule : rules)
+		{
+			if (!matchesWindow(rule, instructions, branchTarget, i))
+				continue;
+			DLXInstruction replacement = rule.rewrite(&instructions[i]);
+			for (size_t k = 1; k < rule.length; k++)
+				instructions[i + k] = nop;
+			instructions[i] = replacement;
+		}
+	}
+}
+
+void DLXPeepholeOptimizer::discardDeadResults(vector<DLXInstruction>& instructions, uint32_t liveOnExit)
+{
+	DLXLivenessAnalysis liveness(instructions, liveOnExit);
+	const DLXInstruction nop = makeInstruction(OP_NOP, 0, 0, 0, 0);
+	for (size_t i = 0; i < instructions.size(); i++)
+	{
+		DLXInstruction& instr = instructions[i];
+		if (liveness.getLiveAfter(i) & ((DLXLivenessAnalysis::RegisterSet)1 << instr.rd))
+			continue;
+		switch (instr.opcode)
+		{
+		case OP_ADD:
+		case OP_ADDI:
+		case OP_SUBI:
+		case OP_MULADD:
+		case OP_LOOPCHECK:
+		case OP_LI:
+		case OP_MOV:
+			instr = nop;
+			break;
+		case OP_LOOPCHECK_BRLE:
+		case OP_LOOPCHECK_BRGE:
+			instr.rd = 0;
+			break;
+		default:
+			break;
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "DLXInstruction.h"
+
+//Rewrites short windows of instructions into cheaper or fused ones before
+//code generation. Rules are kept in a table in DLXPeepholeOptimizer.cpp.
+//A matched window is replaced by one instruction followed by NOPs, so
+//positions of instructions (branch targets, source lines) do not change.
+//Windows never span a branch target. Afterwards results that are never read
+//are discarded.
+class DLXPeepholeOptimizer
+{
+public:
+	//liveOnExit: registers whose final values have to be kept, see DLXLivenessAnalysis
+	static void optimize(std::vector<DLXInstruction>& instructions, uint32_t liveOnExit = 0);
+private:
+	static void applyRules(std::vector<DLXInstruction>& instructions);
+	//fused branches keep only the branch, other instructions without side effects become NOPs
+	static void discardDeadResults(std::vector<DLXInstruction>& instructions, uint32_t liveOnExit);
+};
@@ -0,0 +1,159 @@
+#include "DLXPerfMap.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "DLXJITException.h"
+
+using namespace std;
+
+//records of the jitdump format, see tools/perf/Documentation/jitdump-specification.txt
+static const uint32_t jitDumpMagic = 0x4A695444;
+static const uint32_t jitDumpVersion = 1;
+static const uint32_t jitCodeLoad = 0;
+
+struct JitDumpHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t totalSize;
+	uint32_t elfMachine;
+	uint32_t pad;
+	uint32_t pid;
+	uint64_t timestamp;
+	uint64_t flags;
+};
+
+struct JitCodeLoad
+{
+	uint32_t id;
+	uint32_t totalSize;
+	uint64_t timestamp;
+	uint32_t pid;
+	uint32_t tid;
+	uint64_t vma;
+	uint64_t codeAddress;
+	uint64_t codeSize;
+	uint64_t codeIndex;
+	//followed by the name with its terminating 0 and the code
+};
+
+//clock of perf record -k mono
+static uint64_t getTimestamp()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+DLXPerfMap& DLXPerfMap::instance()
+{
+	//never destroyed, programs may be compiled by destructors of static objects
+	static DLXPerfMap* perfMap = new DLXPerfMap();
+	return *perfMap;
+}
+
+DLXPerfMap::DLXPerfMap()
+	: map(nullptr), jitDump(nullptr), codeIndex(0)
+{
+}
+
+void DLXPerfMap::open(bool withJitDump)
+{
+	lock_guard<std::mutex> lock(mutex);
+	if (map != nullptr)
+		return;
+	string mapName = "/tmp/perf-" + to_string(getpid()) + ".map";
+	FILE* file = fopen(mapName.c_str(), "a");
+	if (file == nullptr)
+		throw DLXJITException("Unable to open " + mapName + ": " + strerror(errno));
+	if (withJitDump)
+	{
+		try
+		{
+			openJitDump();
+		}
+		catch (...)
+		{
+			fclose(file);
+			throw;
+		}
+	}
+	map = file;
+}
+
+void DLXPerfMap::openJitDump()
+{
+	string name = "/tmp/jit-" + to_string(getpid()) + ".dump";
+	int fd = ::open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+	if (fd < 0)
+		throw DLXJITException("Unable to open " + name + ": " + strerror(errno));
+	//perf record sees the file through an executable mapping of it, which stays for the process
+	void* marker = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+	jitDump = marker == MAP_FAILED ? nullptr : fdopen(fd, "w");
+	if (jitDump == nullptr)
+	{
+		string error = strerror(errno);
+		if (marker != MAP_FAILED)
+			munmap(marker, sysconf(_SC_PAGESIZE));
+		close(fd);
+		throw DLXJITException("Unable to map " + name + ": " + error);
+	}
+
+	JitDumpHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = jitDumpMagic;
+	header.version = jitDumpVersion;
+	header.totalSize = sizeof(header);
+#if defined(__arm__)
+	header.elfMachine = EM_ARM;
+#else
+	header.elfMachine = EM_X86_64;
+#endif
+	header.pid = getpid();
+	header.timestamp = getTimestamp();
+	writeJitDump(&header, sizeof(header));
+	fflush(jitDump);
+}
+
+void DLXPerfMap::writeJitDump(const void* data, size_t size)
+{
+	if (fwrite(data, 1, size, jitDump) != size)
+		throw DLXJITException(string("Unable to write the jitdump file: ") + strerror(errno));
+}
+
+bool DLXPerfMap::isOpen()
+{
+	lock_guard<std::mutex> lock(mutex);
+	return map != nullptr;
+}
+
+void DLXPerfMap::add(const void* code, size_t size, const string& name)
+{
+	lock_guard<std::mutex> lock(mutex);
+	if (map == nullptr || size == 0)
+		return;
+	fprintf(map, "%lx %zx %s\n", (unsigned long)(uintptr_t)code, size, name.c_str());
+	fflush(map);
+	if (jitDump == nullptr)
+		return;
+
+	JitCodeLoad record;
+	record.id = jitCodeLoad;
+	record.totalSize = sizeof(record) + name.size() + 1 + size;
+	record.timestamp = getTimestamp();
+	record.pid = getpid();
+	record.tid = syscall(SYS_gettid);
+	record.vma = (uintptr_t)code;
+	record.codeAddress = (uintptr_t)code;
+	record.codeSize = size;
+	record.codeIndex = codeIndex++;
+	writeJitDump(&record, sizeof(record));
+	writeJitDump(name.c_str(), name.size() + 1);
+	writeJitDump(code, size);
+	fflush(jitDump);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+//Names of generated code for Linux perf. Once opened, compiled programs add the
+//code range of every DLX basic block (DLXJIT::addToPerfMap) to /tmp/perf-<pid>.map,
+//which perf report reads by itself. Optionally the ranges and their code also go to
+//a jitdump file, jit-<pid>.dump in /tmp, that perf inject --jit turns into symbols
+//of recorded samples (perf record -k mono). Memory of released programs may be
+//reused by later ones; the map keeps old entries, jitdump orders them by time.
+class DLXPerfMap
+{
+public:
+	static DLXPerfMap& instance();
+
+	//throws DLXJITException when a file can not be created, further calls do nothing
+	void open(bool jitDump);
+	bool isOpen();
+	//names size bytes of code at address, nothing happens when not open
+	void add(const void* code, std::size_t size, const std::string& name);
+private:
+	DLXPerfMap();
+	DLXPerfMap(const DLXPerfMap&) = delete;
+	DLXPerfMap& operator=(const DLXPerfMap&) = delete;
+
+	void openJitDump();
+	void writeJitDump(const void* data, std::size_t size);
+
+	FILE* map;
+	FILE* jitDump;
+	//index of the next code load record
+	uint64_t codeIndex;
+	std::mutex mutex;
+};
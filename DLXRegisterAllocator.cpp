@@ -0,0 +1,104 @@
+#include "DLXRegisterAllocator.h"
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+const int DLXRegisterAllocator::SPILLED;
+
+//loops deeper than this are weighted as this one
+static const int maxWeightedLoopDepth = 6;
+static const double loopWeightFactor = 8.0;
+
+struct LiveInterval
+{
+	int dlxRegister;
+	size_t start;
+	size_t end;
+	double weight;
+};
+
+DLXRegisterAllocator::DLXRegisterAllocator(const vector<DLXInstruction>& instructions, const DLXLivenessAnalysis& liveness, int numberOfDLXRegisters, int numberOfHostRegisters)
+	: hostRegisters(numberOfDLXRegisters, SPILLED)
+{
+	size_t count = instructions.size();
+
+	//every backward branch closes a loop spanning from its target
+	vector<int> loopDepthChange(count + 1, 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (isBranch(instructions[i]) && instructions[i].target <= i)
+		{
+			loopDepthChange[instructions[i].target]++;
+			loopDepthChange[i + 1]--;
+		}
+	}
+
+	vector<LiveInterval> intervals(numberOfDLXRegisters);
+	for (int no = 0; no < numberOfDLXRegisters; no++)
+		intervals[no] = { no, SIZE_MAX, 0, 0.0 };
+
+	int loopDepth = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		loopDepth += loopDepthChange[i];
+		double weight = 1.0;
+		for (int d = 0; d < min(loopDepth, maxWeightedLoopDepth); d++)
+			weight *= loopWeightFactor;
+
+		DLXLivenessAnalysis::RegisterSet accessed = DLXLivenessAnalysis::getUsedRegisters(instructions[i]) | DLXLivenessAnalysis::getDefinedRegisters(instructions[i]);
+		DLXLivenessAnalysis::RegisterSet touched = accessed | liveness.getLiveAfter(i) | liveness.getLiveBefore(i);
+		for (int no = 1; no < numberOfDLXRegisters; no++)
+		{
+			DLXLivenessAnalysis::RegisterSet bit = (DLXLivenessAnalysis::RegisterSet)1 << no;
+			if (touched & bit)
+			{
+				intervals[no].start = min(intervals[no].start, i);
+				intervals[no].end = i;
+			}
+			if (accessed & bit)
+				intervals[no].weight += weight;
+		}
+	}
+
+	intervals.erase(remove_if(intervals.begin(), intervals.end(), [](const LiveInterval& interval) { return interval.start == SIZE_MAX; }), intervals.end());
+	sort(intervals.begin(), intervals.end(), [](const LiveInterval& a, const LiveInterval& b) {
+		return a.start != b.start ? a.start < b.start : a.weight > b.weight;
+	});
+
+	vector<bool> hostRegisterTaken(numberOfHostRegisters, false);
+	vector<const LiveInterval*> active;
+	for (const LiveInterval& current : intervals)
+	{
+		//intervals ending before this one starts give their registers back
+		for (auto it = active.begin(); it != active.end();)
+		{
+			if ((*it)->end < current.start)
+			{
+				hostRegisterTaken[hostRegisters[(*it)->dlxRegister]] = false;
+				it = active.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		auto freeRegister = find(hostRegisterTaken.begin(), hostRegisterTaken.end(), false);
+		if (freeRegister != hostRegisterTaken.end())
+		{
+			*freeRegister = true;
+			hostRegisters[current.dlxRegister] = freeRegister - hostRegisterTaken.begin();
+			active.push_back(&current);
+			continue;
+		}
+
+		auto lightest = min_element(active.begin(), active.end(), [](const LiveInterval* a, const LiveInterval* b) { return a->weight < b->weight; });
+		if (lightest != active.end() && (*lightest)->weight < current.weight)
+		{
+			hostRegisters[current.dlxRegister] = hostRegisters[(*lightest)->dlxRegister];
+			hostRegisters[(*lightest)->dlxRegister] = SPILLED;
+			*lightest = &current;
+		}
+	}
+}
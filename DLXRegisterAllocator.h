@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "DLXInstruction.h"
+#include "DLXLivenessAnalysis.h"
+
+//Linear scan assignment of DLX registers to a pool of host registers.
+//Every DLX register gets one live interval covering all instructions where it
+//is live or written, registers with disjoint intervals may share a host
+//register. When the pool runs out the interval with the lowest weight (uses
+//scaled by loop nesting depth) stays in its stack slot for the whole program.
+class DLXRegisterAllocator
+{
+public:
+	static const int SPILLED = -1;
+
+	DLXRegisterAllocator(const std::vector<DLXInstruction>& instructions, const DLXLivenessAnalysis& liveness, int numberOfDLXRegisters, int numberOfHostRegisters);
+
+	//index in the host register pool or SPILLED
+	int getHostRegister(int dlxRegister) const { return hostRegisters[dlxRegister]; }
+private:
+	std::vector<int> hostRegisters;
+};
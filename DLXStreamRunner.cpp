@@ -0,0 +1,83 @@
+#include "DLXStreamRunner.h"
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+
+using namespace std;
+
+DLXStreamRunner::DLXStreamRunner(shared_ptr<const DLXCompiledProgram> program, DLXExecutionContext& context, Region input, Region output)
+	: program(program), context(context), input(input), output(output)
+{
+	if (input.words == 0 || output.words == 0)
+		throw DLXJITException("Stream regions can not be empty");
+	//accessing the last words grows memory to hold both regions before the first block
+	DLXDataMemory& memory = context.getDataMemory();
+	for (const Region& region : { input, output })
+		memory.loadWord((size_t)region.address + (size_t)(region.words - 1) * 4);
+}
+
+DLXStreamRunner::Region DLXStreamRunner::parseRegion(const string& text)
+{
+	const char* begin = text.c_str();
+	char* end;
+	Region region;
+	region.address = (uint32_t)strtoul(begin, &end, 16);
+	if (end == begin || *end != ':')
+		throw DLXJITException("Invalid stream region: " + text);
+	begin = end + 1;
+	region.words = (uint32_t)strtoul(begin, &end, 10);
+	if (end == begin || *end != '\0' || region.words == 0)
+		throw DLXJITException("Invalid stream region: " + text);
+	if (region.address % 4 != 0)
+		throw DLXJITException("Stream region is not word aligned: " + text);
+	return region;
+}
+
+uint32_t DLXStreamRunner::readBlock(istream& samples)
+{
+	DLXDataMemory& memory = context.getDataMemory();
+	uint32_t count = 0;
+	string token;
+	while (count < input.words && samples >> token)
+	{
+		char* end;
+		uint32_t value = (uint32_t)strtoul(token.c_str(), &end, 16);
+		if (*end != '\0')
+			throw DLXJITException("Invalid sample: " + token);
+		memory.saveWord(input.address + count * 4, value);
+		count++;
+	}
+	for (uint32_t i = count; count > 0 && i < input.words; i++)
+		memory.saveWord(input.address + i * 4, 0);
+	return count;
+}
+
+void DLXStreamRunner::writeBlock(ostream& stream, uint32_t words)
+{
+	DLXDataMemory& memory = context.getDataMemory();
+	char line[16];
+	for (uint32_t i = 0; i < words; i++)
+	{
+		int length = snprintf(line, sizeof(line), "%08x\n", memory.loadWord(output.address + i * 4));
+		stream.write(line, length);
+	}
+	stream.flush();
+}
+
+size_t DLXStreamRunner::run(istream& samples, ostream& stream)
+{
+	size_t blocks = 0;
+	uint32_t count;
+	while ((count = readBlock(samples)) > 0)
+	{
+		program->execute(context);
+		blocks++;
+		writeBlock(stream, (uint32_t)((uint64_t)output.words * count / input.words));
+		if (count < input.words)
+			break;
+	}
+	if (samples.bad())
+		throw DLXJITException("Unable to read samples");
+	return blocks;
+}
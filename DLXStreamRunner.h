@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include "DLXJIT.h"
+
+//Runs one compiled program over an unbounded stream of samples, like the
+//FIR filter in soi.cod. Every block of input samples is stored into the
+//input region of data memory, the program is executed and the output region
+//is written out. The execution context is kept between blocks, so the rest
+//of data memory (coefficients, circular buffer history) and kept final
+//registers carry over to the next block.
+class DLXStreamRunner
+{
+public:
+	//words at a DLX byte address
+	struct Region
+	{
+		uint32_t address;
+		uint32_t words;
+	};
+
+	DLXStreamRunner(std::shared_ptr<const DLXCompiledProgram> program, DLXExecutionContext& context, Region input, Region output);
+
+	//"ADDRESS:WORDS", address in hexadecimal like in .dat files
+	static Region parseRegion(const std::string& text);
+
+	//samples are whitespace separated hexadecimal words, output has one word
+	//per line and is flushed after every block. A last partial block is
+	//padded with zeros and only its share of the output block is written.
+	//Returns the number of blocks executed.
+	std::size_t run(std::istream& samples, std::ostream& output);
+private:
+	//returns the number of samples read, 0 at the end of the stream
+	uint32_t readBlock(std::istream& samples);
+	void writeBlock(std::ostream& output, uint32_t words);
+
+	std::shared_ptr<const DLXCompiledProgram> program;
+	DLXExecutionContext& context;
+	Region input;
+	Region output;
+};
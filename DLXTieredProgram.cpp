@@ -0,0 +1,78 @@
+#include "DLXTieredProgram.h"
+#include <cstring>
+
+using namespace std;
+
+DLXTieredProgram::DLXTieredProgram(DLXDataByteOrder byteOrder, size_t dataMemorySize, const InstructionCollection& instructions,
+	vector<uint32_t>&& addresses, bool finalRegistersKept, unsigned threshold, weak_ptr<DLXJIT> compiler)
+	: DLXInterpretedProgram(byteOrder, dataMemorySize, makeOps(instructions), makeOpAddresses(move(addresses)), finalRegistersKept),
+	threshold(threshold), compiler(compiler)
+{
+}
+
+vector<uint32_t> DLXTieredProgram::makeOpAddresses(vector<uint32_t>&& addresses)
+{
+	//the end of the program
+	addresses.push_back(0);
+	return move(addresses);
+}
+
+DLXTieredProgram::InstructionCollection DLXTieredProgram::makeOps(const InstructionCollection& instructions)
+{
+	InstructionCollection ops(instructions);
+	for (auto& op : ops)
+	{
+		//writing to R0 is not allowed, so such instructions do nothing
+		if (op.rd == 0 && op.opcode != OP_STW && !isBranch(op))
+			op.opcode = OP_NOP;
+	}
+	DLXInstruction halt = { OP_HALT, 0, 0, 0, 0, 0 };
+	ops.push_back(halt);
+	return ops;
+}
+
+shared_ptr<const DLXCompiledProgram> DLXTieredProgram::getNativeProgram(size_t position) const
+{
+	lock_guard<std::mutex> lock(mutex);
+	auto found = nativePrograms.find(position);
+	if (found != nativePrograms.end())
+		return found->second;
+	shared_ptr<const DLXCompiledProgram> program;
+	auto owner = compiler.lock();
+	if (owner)
+		program = owner->compileFrom(position);
+	nativePrograms[position] = program;
+	return program;
+}
+
+void DLXTieredProgram::execute(DLXExecutionContext& context) const
+{
+	prepareContext(context);
+	const int numberOfRegisters = DLXExecutionContext::numberOfRegisters;
+	uint32_t regs[numberOfRegisters + 1];
+	memcpy(regs, context.getRegisters(), numberOfRegisters * sizeof(uint32_t));
+
+	//loops compiled by earlier executions are entered on their first iteration
+	vector<uint32_t> counters(ops.size(), 0);
+	{
+		lock_guard<std::mutex> lock(mutex);
+		for (const auto& native : nativePrograms)
+			counters[native.first] = native.second ? threshold - 1 : 0;
+	}
+
+	size_t position = interpret<true>(context, regs, 0, counters.data(), threshold);
+	if (position < ops.size())
+	{
+		auto native = getNativeProgram(position);
+		if (native)
+		{
+			memcpy(context.getRegisters(), regs, numberOfRegisters * sizeof(uint32_t));
+			native->execute(context);
+			return;
+		}
+		//no native code, the rest is interpreted without counting
+		interpret<false>(context, regs, position, nullptr, 0);
+	}
+	if (finalRegistersKept)
+		memcpy(context.getRegisters(), regs, numberOfRegisters * sizeof(uint32_t));
+}
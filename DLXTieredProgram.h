@@ -0,0 +1,32 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include "DLXInterpreter.h"
+
+//Program of a DLXJIT with a tiering threshold. Every execution starts in the
+//interpreter and counts the iterations of each loop. When a loop reaches the
+//threshold, the rest of the execution continues in native code that starts
+//at the loop header. That code is compiled once and entered by later
+//executions on their first iteration of the loop.
+class DLXTieredProgram : public DLXInterpretedProgram
+{
+public:
+	//instructions as loaded, addresses of their .cod lines; compiler generates the
+	//native code and may be gone by then
+	DLXTieredProgram(DLXDataByteOrder byteOrder, std::size_t dataMemorySize, const InstructionCollection& instructions,
+		std::vector<uint32_t>&& addresses, bool finalRegistersKept, unsigned threshold, std::weak_ptr<DLXJIT> compiler);
+
+	void execute(DLXExecutionContext& context) const override;
+private:
+	//one op per instruction, so positions are the same in both
+	static InstructionCollection makeOps(const InstructionCollection& instructions);
+	static std::vector<uint32_t> makeOpAddresses(std::vector<uint32_t>&& addresses);
+	//native code entered at the instruction, compiled on the first call; empty when there is no compiler
+	std::shared_ptr<const DLXCompiledProgram> getNativeProgram(std::size_t position) const;
+
+	const unsigned threshold;
+	const std::weak_ptr<DLXJIT> compiler;
+	mutable std::mutex mutex;
+	mutable std::map<std::size_t, std::shared_ptr<const DLXCompiledProgram>> nativePrograms;
+};
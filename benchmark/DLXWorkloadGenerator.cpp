@@ -0,0 +1,418 @@
+#include "DLXWorkloadGenerator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include "DLXDatFile.h"
+#include "DLXDataMemory.h"
+#include "DLXInstructionDecoder.h"
+#include "DLXJITException.h"
+
+using namespace std;
+
+//.cod text of a program, branches refer to labels that may come later
+class CodWriter
+{
+public:
+	void label(const string& name)
+	{
+		labels[name] = lines.size();
+		pendingLabel = name;
+	}
+	void add(int rs1, int rs2, int rd)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "R%d, R%d, R%d", rs1, rs2, rd);
+		append(DLX_SPECIAL << 26 | rs1 << 21 | rs2 << 16 | rd << 11 | DLX_FUNC_ADD, "ADD", text);
+	}
+	void muladd(int rs1, int rs2, int rd)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "R%d, R%d, R%d", rs1, rs2, rd);
+		append((uint32_t)DLX_MULADD << 26 | rs1 << 21 | rs2 << 16 | rd << 11, "MULADD", text);
+	}
+	void addi(int rs1, int32_t imm, int rd) { immediate(DLX_ADDI, "ADDI", rs1, imm, rd); }
+	void subi(int rs1, int32_t imm, int rd) { immediate(DLX_SUBI, "SUBI", rs1, imm, rd); }
+	void loopcheck(int rs1, int32_t imm, int rd) { immediate(DLX_LOOPCHECK, "LOOPCHECK", rs1, imm, rd); }
+	void ldw(int rd, int32_t imm, int rs1)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "R%d, 0x%04X(R%d)", rd, imm & 0xFFFF, rs1);
+		append(checkImmediate(DLX_LDW << 26 | rs1 << 21 | rd << 16, imm), "LDW", text);
+	}
+	void stw(int rs2, int32_t imm, int rs1)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "R%d, 0x%04X(R%d)", rs2, imm & 0xFFFF, rs1);
+		append(checkImmediate(DLX_STW << 26 | rs1 << 21 | rs2 << 16, imm), "STW", text);
+	}
+	void brle(int reg, const string& target) { branch(DLX_BRLE, "BRLE", reg, target); }
+	void brge(int reg, const string& target) { branch(DLX_BRGE, "BRGE", reg, target); }
+	void nop() { append(0, "NOP", ""); }
+	//value in any 32 bit register, with ADDI or SUBI of 14 bit parts and doubling
+	void constant(int64_t value, int rd)
+	{
+		if (value >= -0x8000 && value <= 0x7FFF)
+		{
+			addi(0, (int32_t)value, rd);
+			return;
+		}
+		bool negative = value < 0;
+		uint64_t magnitude = negative ? -value : value;
+		if (negative)
+			subi(0, (int32_t)(magnitude >> 14), rd);
+		else
+			addi(0, (int32_t)(magnitude >> 14), rd);
+		for (int i = 0; i < 14; i++)
+			add(rd, rd, rd);
+		if ((magnitude & 0x3FFF) != 0)
+		{
+			if (negative)
+				subi(rd, magnitude & 0x3FFF, rd);
+			else
+				addi(rd, magnitude & 0x3FFF, rd);
+		}
+	}
+	size_t size() const { return lines.size(); }
+
+	void save(const string& fileName)
+	{
+		FILE* file = fopen(fileName.c_str(), "w");
+		if (file == nullptr)
+			throw DLXJITException("Unable to write " + fileName);
+		fprintf(file, "[Code Memory Content]\n");
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			Line& line = lines[i];
+			if (!line.target.empty())
+			{
+				auto target = labels.find(line.target);
+				if (target == labels.end())
+					throw DLXJITException("Unknown label " + line.target);
+				int64_t offset = ((int64_t)target->second - (int64_t)i - 1) * 4;
+				if (offset < -0x8000 || offset > 0x7FFF)
+					throw DLXJITException("Branch to " + line.target + " out of range");
+				line.icode |= offset & 0xFFFF;
+			}
+			fprintf(file, "%04zX: %08X | %-10s | %-9s %s\n", i * 4, line.icode, line.label.c_str(), line.mnemonic, line.text.c_str());
+		}
+		if (fclose(file) != 0)
+			throw DLXJITException("Unable to write " + fileName);
+	}
+private:
+	struct Line
+	{
+		uint32_t icode;
+		string label;
+		const char* mnemonic;
+		string text;
+		//branches only
+		string target;
+	};
+
+	static uint32_t checkImmediate(uint32_t icode, int32_t imm)
+	{
+		if (imm < -0x8000 || imm > 0x7FFF)
+			throw DLXJITException("Immediate " + to_string(imm) + " out of range");
+		return icode | (imm & 0xFFFF);
+	}
+	void immediate(uint32_t opcode, const char* mnemonic, int rs1, int32_t imm, int rd)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "R%d, 0x%04X, R%d", rs1, imm & 0xFFFF, rd);
+		append(checkImmediate(opcode << 26 | rs1 << 21 | rd << 16, imm), mnemonic, text);
+	}
+	void branch(uint32_t opcode, const char* mnemonic, int reg, const string& target)
+	{
+		append(opcode << 26 | reg << 16, mnemonic, "R" + to_string(reg) + ", " + target);
+		lines.back().target = target;
+	}
+	void append(uint32_t icode, const char* mnemonic, const string& text)
+	{
+		lines.push_back({ icode, pendingLabel, mnemonic, text, "" });
+		pendingLabel.clear();
+	}
+
+	vector<Line> lines;
+	map<string, size_t> labels;
+	string pendingLabel;
+};
+
+//same sequence on every run and host
+class Random
+{
+public:
+	explicit Random(uint32_t seed) : state(seed) {}
+	uint32_t next()
+	{
+		state = state * 1664525 + 1013904223;
+		return state >> 8;
+	}
+private:
+	uint32_t state;
+};
+
+static void saveData(const string& fileName, const vector<uint32_t>& words)
+{
+	DLXDataMemory memory;
+	memory.saveWords(0, words.data(), words.size());
+	DLXDatFile::save(fileName, memory);
+}
+
+DLXWorkload DLXWorkloadGenerator::generate(const string& specification, const string& directory)
+{
+	auto separator = specification.find(':');
+	string kind = specification.substr(0, separator);
+	map<string, size_t> parameters;
+	if (separator != string::npos)
+	{
+		size_t start = separator + 1;
+		while (start < specification.size())
+		{
+			auto end = specification.find(',', start);
+			if (end == string::npos)
+				end = specification.size();
+			string parameter = specification.substr(start, end - start);
+			auto equals = parameter.find('=');
+			char* valueEnd = nullptr;
+			unsigned long long value = equals == string::npos ? 0 : strtoull(parameter.c_str() + equals + 1, &valueEnd, 0);
+			if (equals == string::npos || *valueEnd != '\0' || value == 0)
+				throw DLXJITException("Invalid workload parameter: " + parameter);
+			parameters[parameter.substr(0, equals)] = value;
+			start = end + 1;
+		}
+	}
+	auto get = [&](const string& name, size_t defaultValue)
+	{
+		auto parameter = parameters.find(name);
+		if (parameter == parameters.end())
+			return defaultValue;
+		size_t value = parameter->second;
+		parameters.erase(parameter);
+		return value;
+	};
+
+	string prefix = directory + "/dlxbench_" + kind;
+	DLXWorkload workload;
+	if (kind == "fir")
+	{
+		size_t taps = get("taps", 16);
+		size_t samples = get("samples", 32);
+		prefix += "_" + to_string(taps) + "_" + to_string(samples);
+		workload = fir(taps, samples, prefix);
+	}
+	else if (kind == "straight" || kind == "loops")
+	{
+		size_t instructions = get("instructions", 10000);
+		prefix += "_" + to_string(instructions);
+		workload = kind == "straight" ? straight(instructions, prefix) : loops(instructions, prefix);
+	}
+	else
+		throw DLXJITException("Unknown workload: " + kind);
+	if (!parameters.empty())
+		throw DLXJITException("Unknown parameter " + parameters.begin()->first + " of workload " + kind);
+	workload.name = specification;
+	return workload;
+}
+
+void DLXWorkloadGenerator::remove(const DLXWorkload& workload, const string& outputName)
+{
+	std::remove(workload.codName.c_str());
+	std::remove(workload.datName.c_str());
+	std::remove(outputName.c_str());
+}
+
+DLXWorkload DLXWorkloadGenerator::fir(size_t taps, size_t samples, const string& prefix)
+{
+	//inputs, delay line, coefficients, outputs
+	const size_t inputs = 0;
+	const size_t delayLine = inputs + 4 * samples;
+	const size_t coefficients = delayLine + 4 * taps;
+	const size_t outputs = coefficients + 4 * taps;
+	if (outputs + 4 * samples > 0x7FFFFFFF)
+		throw DLXJITException("FIR workload does not fit into data memory");
+
+	CodWriter cod;
+	if (outputs <= 0x7FFF)
+	{
+		//soi.cod with other sizes
+		cod.addi(0, 0, 4);
+		cod.addi(0, 0, 1);
+		cod.label("for1");
+		cod.ldw(7, inputs, 1);
+		cod.stw(7, delayLine, 4);
+		cod.addi(0, 0, 3);
+		cod.addi(4, 0, 5);
+		cod.addi(0, 0, 2);
+		cod.label("for2");
+		cod.ldw(9, delayLine, 5);
+		cod.ldw(10, coefficients, 2);
+		cod.muladd(9, 10, 3);
+		cod.addi(5, 4, 5);
+		cod.loopcheck(5, 4 * taps - 4, 6);
+		cod.brge(6, "keepR5");
+		cod.addi(0, 0, 5);
+		cod.label("keepR5");
+		cod.addi(2, 4, 2);
+		cod.loopcheck(2, 4 * taps - 4, 6);
+		cod.brge(6, "for2");
+		cod.stw(3, outputs, 1);
+		cod.subi(4, 4, 4);
+		cod.brge(4, "keepR4");
+		cod.addi(0, 4 * taps - 4, 4);
+		cod.label("keepR4");
+		cod.addi(1, 4, 1);
+		cod.loopcheck(1, 4 * samples - 4, 6);
+		cod.brge(6, "for1");
+	}
+	else
+	{
+		//same filter with pointers; R25 and R26 hold negated bounds, there is no SUB
+		const size_t lastDelay = delayLine + 4 * taps - 4;
+		cod.constant(inputs, 11);
+		cod.constant(outputs, 14);
+		cod.constant(samples - 1, 20);
+		cod.constant(delayLine, 21);
+		cod.constant(lastDelay, 22);
+		cod.constant(coefficients, 23);
+		cod.constant(taps - 1, 24);
+		cod.constant(-(int64_t)lastDelay, 25);
+		cod.constant(-(int64_t)delayLine, 26);
+		cod.add(21, 0, 4);
+		cod.label("for1");
+		cod.ldw(7, 0, 11);
+		cod.stw(7, 0, 4);
+		cod.addi(0, 0, 3);
+		cod.add(4, 0, 5);
+		cod.add(23, 0, 2);
+		cod.add(24, 0, 16);
+		cod.label("for2");
+		cod.ldw(9, 0, 5);
+		cod.ldw(10, 0, 2);
+		cod.muladd(9, 10, 3);
+		cod.addi(5, 4, 5);
+		cod.add(5, 25, 6);
+		cod.brle(6, "keepR5");
+		cod.add(21, 0, 5);
+		cod.label("keepR5");
+		cod.addi(2, 4, 2);
+		cod.subi(16, 1, 16);
+		cod.brge(16, "for2");
+		cod.stw(3, 0, 14);
+		cod.addi(14, 4, 14);
+		cod.addi(11, 4, 11);
+		cod.subi(4, 4, 4);
+		cod.add(4, 26, 6);
+		cod.brge(6, "keepR4");
+		cod.add(22, 0, 4);
+		cod.label("keepR4");
+		cod.subi(20, 1, 20);
+		cod.brge(20, "for1");
+	}
+	cod.nop();
+
+	vector<uint32_t> data((outputs + 4 * samples) / 4, 0);
+	Random random(1);
+	for (size_t i = 0; i < samples; i++)
+		data[inputs / 4 + i] = random.next() & 0xFFFF;
+	for (size_t k = 0; k < taps; k++)
+		data[coefficients / 4 + k] = random.next() & 0xFF;
+
+	DLXWorkload workload;
+	workload.codName = prefix + ".cod";
+	workload.datName = prefix + ".dat";
+	workload.instructions = cod.size();
+	workload.outputAddress = outputs;
+	//y[i] = sum of c[k] * x[i - k], the delay line starts empty
+	workload.expectedOutput.resize(samples);
+	for (size_t i = 0; i < samples; i++)
+	{
+		uint32_t sum = 0;
+		for (size_t k = 0; k < taps && k <= i; k++)
+			sum += data[coefficients / 4 + k] * data[inputs / 4 + i - k];
+		workload.expectedOutput[i] = sum;
+	}
+	cod.save(workload.codName);
+	saveData(workload.datName, data);
+	return workload;
+}
+
+DLXWorkload DLXWorkloadGenerator::straight(size_t instructions, const string& prefix)
+{
+	const size_t words = 1024;
+	vector<uint32_t> data(words);
+	Random random(2);
+	for (auto& word : data)
+		word = random.next();
+
+	//groups of load, add immediate, add and store over 30 registers, simulated along
+	CodWriter cod;
+	vector<uint32_t> memory(data);
+	uint32_t registers[32] = { 0 };
+	for (size_t group = 0; group < instructions / 4; group++)
+	{
+		int a = 1 + group % 15;
+		int b = 16 + group % 15;
+		int32_t load = (group * 4) % (words * 4);
+		int32_t store = (group * 20 + 64) % (words * 4);
+		int32_t increment = 1 + group % 100;
+		cod.ldw(a, load, 0);
+		cod.addi(a, increment, a);
+		cod.add(a, b, b);
+		cod.stw(b, store, 0);
+		registers[a] = memory[load / 4] + increment;
+		registers[b] += registers[a];
+		memory[store / 4] = registers[b];
+	}
+	while (cod.size() < instructions)
+		cod.nop();
+
+	DLXWorkload workload;
+	workload.codName = prefix + ".cod";
+	workload.datName = prefix + ".dat";
+	workload.instructions = cod.size();
+	workload.outputAddress = 0;
+	workload.expectedOutput = move(memory);
+	cod.save(workload.codName);
+	saveData(workload.datName, data);
+	return workload;
+}
+
+DLXWorkload DLXWorkloadGenerator::loops(size_t instructions, const string& prefix)
+{
+	//every loop adds to the 16 words of one of 64 arrays
+	const size_t arrays = 64;
+	const size_t length = 16;
+	const size_t loopSize = 7;
+	vector<uint32_t> memory(arrays * length, 0);
+
+	CodWriter cod;
+	for (size_t loop = 0; loop < instructions / loopSize; loop++)
+	{
+		int32_t array = (loop % arrays) * length * 4;
+		int32_t increment = 1 + loop % 7;
+		string label = "loop" + to_string(loop);
+		cod.addi(0, 0, 1);
+		cod.label(label);
+		cod.ldw(2, array, 1);
+		cod.addi(2, increment, 2);
+		cod.stw(2, array, 1);
+		cod.addi(1, 4, 1);
+		cod.loopcheck(1, length * 4 - 4, 6);
+		cod.brge(6, label);
+		for (size_t i = 0; i < length; i++)
+			memory[array / 4 + i] += increment;
+	}
+	while (cod.size() < instructions)
+		cod.nop();
+
+	DLXWorkload workload;
+	workload.codName = prefix + ".cod";
+	workload.datName = prefix + ".dat";
+	workload.instructions = cod.size();
+	workload.outputAddress = 0;
+	workload.expectedOutput = move(memory);
+	cod.save(workload.codName);
+	saveData(workload.datName, vector<uint32_t>(arrays * length, 0));
+	return workload;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Synthetic program with its input, written as a .cod and a .dat file
+struct DLXWorkload
+{
+	std::string name;
+	std::string codName;
+	std::string datName;
+	std::size_t instructions;
+	//words data memory has to hold from outputAddress on after the program ran
+	uint32_t outputAddress;
+	std::vector<uint32_t> expectedOutput;
+};
+
+//Generates the workloads of the benchmark from a specification like
+//"fir:taps=1024,samples=256":
+//  fir       FIR filter in the shape of soi.cod, taps coefficients over samples
+//            inputs with a circular delay line. When the arrays do not fit in
+//            the 16 bit offsets of LDW and STW (4 * samples + 8 * taps > 0x7FFF)
+//            they are addressed through pointer registers and the loops count
+//            down instead, which is not a dot product loop for DOTW
+//  straight  one basic block of instructions loads, adds and stores
+//  loops     short counted loops over small arrays, instructions in total
+//Values are pseudo random but the same on every run; the expected output is
+//computed along.
+class DLXWorkloadGenerator
+{
+public:
+	//throws DLXJITException for unknown workloads, parameters or files that can not be written
+	static DLXWorkload generate(const std::string& specification, const std::string& directory);
+	//the .cod and .dat files and the output file of a run
+	static void remove(const DLXWorkload& workload, const std::string& outputName);
+private:
+	static DLXWorkload fir(std::size_t taps, std::size_t samples, const std::string& prefix);
+	static DLXWorkload straight(std::size_t instructions, const std::string& prefix);
+	static DLXWorkload loops(std::size_t instructions, const std::string& prefix);
+};
@@ -0,0 +1,263 @@
+//Benchmark of the phases of a DLXJIT run over synthetic workloads, see README.md
+#include "DLXJIT.h"
+#include "DLXWorkloadGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+static const char* const phaseNames[] = { "loadCode", "loadData", "compile", "execute", "saveData" };
+static const int numberOfPhases = sizeof(phaseNames) / sizeof(phaseNames[0]);
+
+//used when no --workload is given
+static const char* const defaultWorkloads[] = {
+	"fir:taps=16,samples=32",
+	"fir:taps=1024,samples=1024",
+	"fir:taps=65536,samples=64",
+	"straight:instructions=100000",
+	"loops:instructions=10000"
+};
+
+struct Statistics
+{
+	std::string workload;
+	std::string engine;
+	std::string phase;
+	double min, p50, p90, p99, max, mean;
+};
+
+//nearest rank
+static double percentile(const std::vector<double>& sorted, double rank)
+{
+	std::size_t index = (std::size_t)std::ceil(rank / 100 * sorted.size());
+	return sorted[index == 0 ? 0 : index - 1];
+}
+
+static Statistics summarize(std::vector<double> times)
+{
+	std::sort(times.begin(), times.end());
+	Statistics statistics;
+	statistics.min = times.front();
+	statistics.p50 = percentile(times, 50);
+	statistics.p90 = percentile(times, 90);
+	statistics.p99 = percentile(times, 99);
+	statistics.max = times.back();
+	double sum = 0;
+	for (auto time : times)
+		sum += time;
+	statistics.mean = sum / times.size();
+	return statistics;
+}
+
+//one run of every phase with a new instance, times in microseconds
+static void run(const DLXWorkload& workload, const std::string& engine, const std::string& outputName, double* times)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto elapsed = [](Clock::time_point start) { return std::chrono::duration<double, std::micro>(Clock::now() - start).count(); };
+
+	auto dlx = DLXJIT::createInstance(engine == "interpreter" ? INTERPRETER : engine == "tiered" ? TIERED : NATIVE);
+	dlx->setLazyCompilation(engine == "lazy");
+	auto start = Clock::now();
+	std::ifstream codFile(workload.codName);
+	if (!codFile)
+		throw DLXJITException("Unable to open " + workload.codName);
+	dlx->loadCode(codFile);
+	times[0] = elapsed(start);
+	DLXDataMemory& memory = dlx->getExecutionContext().getDataMemory();
+	start = Clock::now();
+	DLXJIT::loadDataFile(workload.datName, memory);
+	times[1] = elapsed(start);
+	start = Clock::now();
+	dlx->getCompiledProgram();
+	times[2] = elapsed(start);
+	start = Clock::now();
+	dlx->execute();
+	times[3] = elapsed(start);
+	start = Clock::now();
+	DLXJIT::saveDataFile(outputName, memory);
+	times[4] = elapsed(start);
+
+	std::vector<uint32_t> output(workload.expectedOutput.size());
+	memory.loadWords(workload.outputAddress, output.data(), output.size());
+	if (output != workload.expectedOutput)
+		throw DLXJITException("Wrong output of " + workload.name + " with engine " + engine);
+}
+
+static std::string quote(const std::string& text)
+{
+	return "\"" + text + "\"";
+}
+
+//one result per line, so that readBaseline does not need a JSON parser
+static void writeReport(std::ostream& out, const std::string& label, unsigned runs, const std::vector<Statistics>& results)
+{
+	out << "{" << std::endl;
+	out << "  \"label\": " << quote(label) << "," << std::endl;
+	out << "  \"runs\": " << runs << "," << std::endl;
+	out << "  \"results\": [" << std::endl;
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		const Statistics& result = results[i];
+		char times[256];
+		snprintf(times, sizeof(times), "\"min_us\": %.1f, \"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, \"mean_us\": %.1f",
+			result.min, result.p50, result.p90, result.p99, result.max, result.mean);
+		out << "    {\"workload\": " << quote(result.workload) << ", \"engine\": " << quote(result.engine) << ", \"phase\": " <<
+			quote(result.phase) << ", " << times << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl;
+	out << "}" << std::endl;
+}
+
+static std::string getField(const std::string& line, const std::string& name)
+{
+	auto start = line.find("\"" + name + "\": ");
+	if (start == std::string::npos)
+		return "";
+	start += name.size() + 4;
+	if (line[start] == '"')
+		return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+	return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+//p50 of every workload, engine and phase of a report written by writeReport
+static std::map<std::string, double> readBaseline(const std::string& fileName)
+{
+	std::ifstream file(fileName);
+	if (!file)
+		throw DLXJITException("Unable to open " + fileName);
+	std::map<std::string, double> baseline;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::string p50 = getField(line, "p50_us");
+		if (!p50.empty())
+			baseline[getField(line, "workload") + " " + getField(line, "engine") + " " + getField(line, "phase")] = atof(p50.c_str());
+	}
+	return baseline;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> workloads;
+	std::vector<std::string> engines;
+	unsigned runs = 10;
+	std::string directory = "/tmp";
+	std::string label;
+	std::string outputName;
+	std::string baselineName;
+	double tolerance = 10;
+	//differences below are noise, whatever the percentage
+	double minimumDifference = 20;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument(argv[i]);
+		if (argument.compare(0, 11, "--workload=") == 0)
+			workloads.push_back(argument.substr(11));
+		else if (argument.compare(0, 9, "--engine=") == 0)
+			engines.push_back(argument.substr(9));
+		else if (argument.compare(0, 7, "--runs=") == 0)
+			runs = std::max(1, atoi(argument.c_str() + 7));
+		else if (argument.compare(0, 11, "--work-dir=") == 0)
+			directory = argument.substr(11);
+		else if (argument.compare(0, 8, "--label=") == 0)
+			label = argument.substr(8);
+		else if (argument.compare(0, 9, "--output=") == 0)
+			outputName = argument.substr(9);
+		else if (argument.compare(0, 11, "--baseline=") == 0)
+			baselineName = argument.substr(11);
+		else if (argument.compare(0, 12, "--tolerance=") == 0)
+			tolerance = atof(argument.c_str() + 12);
+		else
+		{
+			std::cerr << "Unknown argument " << argument << ". Usage:" << std::endl;
+			std::cerr << "\tdlxbench [--workload=SPEC]... [--engine=native|interpreter|tiered|lazy]... [--runs=N] [--work-dir=DIR]" << std::endl;
+			std::cerr << "\t         [--label=TEXT] [--output=FILE] [--baseline=FILE] [--tolerance=PERCENT]" << std::endl;
+			std::cerr << "SPEC is fir[:taps=N,samples=N], straight[:instructions=N] or loops[:instructions=N]" << std::endl;
+			std::cerr << "--baseline compares the p50 times with an earlier --output and fails on regressions" << std::endl;
+			return -3;
+		}
+	}
+	if (workloads.empty())
+		workloads.assign(std::begin(defaultWorkloads), std::end(defaultWorkloads));
+	if (engines.empty())
+		engines.push_back("native");
+
+	try
+	{
+		for (const auto& engine : engines)
+		{
+			if (engine != "native" && engine != "interpreter" && engine != "tiered" && engine != "lazy")
+				throw DLXJITException("Unknown engine: " + engine);
+		}
+		std::map<std::string, double> baseline;
+		if (!baselineName.empty())
+			baseline = readBaseline(baselineName);
+
+		std::vector<Statistics> results;
+		for (const auto& specification : workloads)
+		{
+			DLXWorkload workload = DLXWorkloadGenerator::generate(specification, directory);
+			std::string resultName = workload.datName + ".out";
+			for (const auto& engine : engines)
+			{
+				std::vector<double> times[numberOfPhases];
+				for (unsigned i = 0; i < runs; i++)
+				{
+					double runTimes[numberOfPhases];
+					run(workload, engine, resultName, runTimes);
+					for (int phase = 0; phase < numberOfPhases; phase++)
+						times[phase].push_back(runTimes[phase]);
+				}
+				std::cerr << workload.name << " (" << workload.instructions << " instructions), " << engine << ":";
+				for (int phase = 0; phase < numberOfPhases; phase++)
+				{
+					Statistics statistics = summarize(times[phase]);
+					statistics.workload = workload.name;
+					statistics.engine = engine;
+					statistics.phase = phaseNames[phase];
+					results.push_back(statistics);
+					std::cerr << " " << phaseNames[phase] << " " << statistics.p50 << " us";
+				}
+				std::cerr << std::endl;
+			}
+			DLXWorkloadGenerator::remove(workload, resultName);
+		}
+
+		if (outputName.empty())
+			writeReport(std::cout, label, runs, results);
+		else
+		{
+			std::ofstream output(outputName);
+			writeReport(output, label, runs, results);
+			if (!output)
+				throw DLXJITException("Unable to write " + outputName);
+		}
+
+		int regressions = 0;
+		for (const auto& result : results)
+		{
+			auto previous = baseline.find(result.workload + " " + result.engine + " " + result.phase);
+			if (previous == baseline.end())
+				continue;
+			double difference = result.p50 - previous->second;
+			if (difference > minimumDifference && difference > previous->second * tolerance / 100)
+			{
+				std::cerr << "Regression: " << result.workload << " " << result.engine << " " << result.phase << ": p50 " <<
+					previous->second << " us -> " << result.p50 << " us" << std::endl;
+				regressions++;
+			}
+		}
+		return regressions > 0 ? 1 : 0;
+	}
+	catch (DLXJITException& ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		return -2;
+	}
+}
@@ -1,6 +1,14 @@
 #include "DLXJIT.h"
+#include "DLXBatchRunner.h"
+#include "DLXMemoryImage.h"
+#include "DLXOutputFile.h"
+#include "DLXPerfMap.h"
+#include "DLXStreamRunner.h"
 #include <fstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
 
 #if defined(WIN32) || defined(_WIN32) 
 #define PATH_SEPARATOR "\\" 
@@ -11,35 +19,172 @@
 int main(int argc, char** argv)
 {
 	const std::ios::iostate exceptionCauses = std::ios::badbit;
-	if (argc < 4)
+	DLXJITEngine engine = NATIVE;
+	bool binaryCode = false;
+	bool hostEndianData = false;
+	bool convert = false;
+	bool lazy = false;
+	DLXExecutionCounting counting = COUNT_NOTHING;
+	bool perfMap = false;
+	bool jitDump = false;
+	int unrollFactor = -1;
+	int tieringThreshold = -1;
+	std::string codeCacheDirectory;
+	std::string batchListName;
+	std::string streamRegions;
+	unsigned threads = 0;
+	std::vector<std::string> arguments;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument(argv[i]);
+		if (argument == "--interpreter")
+			engine = INTERPRETER;
+		else if (argument == "--tiered")
+			engine = TIERED;
+		else if (argument.compare(0, 9, "--tiered=") == 0)
+		{
+			engine = TIERED;
+			tieringThreshold = std::max(1, atoi(argument.c_str() + 9));
+		}
+		else if (argument == "--lazy")
+			lazy = true;
+		else if (argument == "--count=blocks")
+			counting = COUNT_BLOCKS;
+		else if (argument == "--count=instructions")
+			counting = COUNT_INSTRUCTIONS;
+		else if (argument == "--perf-map")
+			perfMap = true;
+		else if (argument == "--perf-map=jitdump")
+			perfMap = jitDump = true;
+		else if (argument == "--binary-code")
+			binaryCode = true;
+		else if (argument == "--host-endian")
+			hostEndianData = true;
+		else if (argument == "--convert")
+			convert = true;
+		else if (argument.compare(0, 9, "--unroll=") == 0)
+			unrollFactor = std::max(1, atoi(argument.c_str() + 9));
+		else if (argument.compare(0, 13, "--code-cache=") == 0)
+			codeCacheDirectory = argument.substr(13);
+		else if (argument.compare(0, 8, "--batch=") == 0)
+			batchListName = argument.substr(8);
+		else if (argument.compare(0, 9, "--stream=") == 0)
+			streamRegions = argument.substr(9);
+		else if (argument.compare(0, 10, "--threads=") == 0)
+			threads = std::max(0, atoi(argument.c_str() + 10));
+		else
+			arguments.push_back(argument);
+	}
+
+	bool batch = !batchListName.empty();
+	bool stream = !streamRegions.empty();
+	if (arguments.size() < (batch ? 1u : stream || convert ? 2u : 3u))
 	{
 		std::string programName(argv[0]);
 		auto lastSep = programName.find_last_of(PATH_SEPARATOR);
 		if (lastSep != std::string::npos)
 			programName = programName.substr(lastSep + 1);
 		std::cerr << "To few arguments. Please perform following call: " << std::endl;
-		std::cerr << "\t" << programName << " input_cod_file input_dat_file output_dat_file" << std::endl;
+		std::cerr << "\t" << programName << " [--interpreter | --tiered[=N]] [--lazy] [--count=blocks|instructions] [--perf-map[=jitdump]] [--binary-code] [--host-endian] [--unroll=N] [--code-cache=DIR] input_cod_file input_dat_file output_dat_file" << std::endl;
+		std::cerr << "\t" << programName << " [options] --batch=LIST_FILE [--threads=N] input_cod_file" << std::endl;
+		std::cerr << "\t" << programName << " [options] --stream=INPUT_ADDRESS:WORDS,OUTPUT_ADDRESS:WORDS input_cod_file input_dat_file" << std::endl;
+		std::cerr << "\t" << programName << " [--host-endian] --convert input_data_file output_data_file" << std::endl;
+		std::cerr << "data files ending with " << DLXMemoryImage::extension << " are binary memory images, others are .dat files" << std::endl;
+		std::cerr << "LIST_FILE holds one \"input_dat_file output_dat_file\" pair per line" << std::endl;
+		std::cerr << "--tiered interprets until a loop ran N times (default " << DLXJIT::defaultTieringThreshold << "), then compiles it" << std::endl;
+		std::cerr << "--lazy generates native code for each basic block when it is reached for the first time" << std::endl;
+		std::cerr << "--count prints the most executed instructions to stderr after the run" << std::endl;
+		std::cerr << "--perf-map names generated code in /tmp/perf-<pid>.map for perf, =jitdump also writes /tmp/jit-<pid>.dump for perf inject" << std::endl;
+		std::cerr << "--stream reads hexadecimal samples from stdin and writes the output words to stdout" << std::endl;
 		return -3;
 	}
 
-	std::string inputCodName(argv[1]);
-	std::string inputDatName(argv[2]);
-	std::string outputDatName(argv[3]);
-
 	try
 	{
-		std::ifstream codFile(inputCodName);
+		if (convert)
+		{
+			DLXDataMemory memory;
+			if (hostEndianData)
+				memory.setByteOrder(DATA_HOST_ENDIAN);
+			DLXJIT::loadDataFile(arguments[0], memory);
+			DLXJIT::saveDataFile(arguments[1], memory);
+			return 0;
+		}
+
+		if (perfMap)
+			DLXPerfMap::instance().open(jitDump);
+		std::string inputCodName(arguments[0]);
+		std::ifstream codFile(inputCodName, binaryCode ? std::ios::in | std::ios::binary : std::ios::in);
 		codFile.exceptions(exceptionCauses);
-		std::ifstream datFile(inputDatName);
-		datFile.exceptions(exceptionCauses);
-		auto dlx = DLXJIT::createInstance();
-		dlx->loadData(datFile);
-		dlx->loadCode(codFile);
+		auto dlx = DLXJIT::createInstance(engine);
+		if (hostEndianData)
+			dlx->setDataByteOrder(DATA_HOST_ENDIAN);
+		if (unrollFactor > 0)
+			dlx->setLoopUnrollFactor(unrollFactor);
+		if (tieringThreshold > 0)
+			dlx->setTieringThreshold(tieringThreshold);
+		dlx->setLazyCompilation(lazy);
+		dlx->setExecutionCounting(counting);
+		dlx->setCodeCacheDirectory(codeCacheDirectory);
+
+		if (batch)
+		{
+			std::ifstream listFile(batchListName);
+			listFile.exceptions(exceptionCauses);
+			if (!listFile)
+				throw DLXJITException("Unable to open " + batchListName);
+			auto jobs = DLXBatchRunner::readJobList(listFile);
+			if (binaryCode)
+				dlx->loadBinaryCode(codFile);
+			else
+				dlx->loadCode(codFile);
+			DLXBatchRunner runner(dlx->getCompiledProgram(), threads);
+			if (runner.run(jobs) > 0)
+			{
+				for (const auto& job : jobs)
+				{
+					if (!job.error.empty())
+						std::cerr << job.error << std::endl;
+				}
+				return -2;
+			}
+			std::cout << "end";
+			return 0;
+		}
+
+		std::string inputDatName(arguments[1]);
+		//an image that is also the output is mapped shared, results go straight to the file
+		bool inPlace = !stream && DLXOutputFile::isSameFile(arguments[2], inputDatName) && DLXMemoryImage::isImage(inputDatName);
+		if (inPlace)
+			DLXMemoryImage::load(inputDatName, dlx->getExecutionContext().getDataMemory(), true);
+		else
+			DLXJIT::loadDataFile(inputDatName, dlx->getExecutionContext().getDataMemory());
+		if (binaryCode)
+			dlx->loadBinaryCode(codFile);
+		else
+			dlx->loadCode(codFile);
+
+		if (stream)
+		{
+			auto separator = streamRegions.find(',');
+			if (separator == std::string::npos)
+				throw DLXJITException("Invalid stream regions: " + streamRegions);
+			DLXStreamRunner runner(dlx->getCompiledProgram(), dlx->getExecutionContext(),
+				DLXStreamRunner::parseRegion(streamRegions.substr(0, separator)),
+				DLXStreamRunner::parseRegion(streamRegions.substr(separator + 1)));
+			std::ios::sync_with_stdio(false);
+			runner.run(std::cin, std::cout);
+			return 0;
+		}
+
+		std::string outputDatName(arguments[2]);
 		dlx->execute();
-		std::ofstream odatFile(outputDatName);
-		odatFile.exceptions(exceptionCauses);
-		dlx->saveData(odatFile);
-		std::cout << odatFile << "end";
+		if (counting != COUNT_NOTHING)
+			dlx->printHotspots(std::cerr, 20);
+		//memory grown past the image is no longer shared with the file
+		if (!inPlace || !dlx->getExecutionContext().getDataMemory().isShared())
+			DLXJIT::saveDataFile(outputDatName, dlx->getExecutionContext().getDataMemory());
+		std::cout << "end";
 		return 0;
 	}
 	catch (DLXJITException& ex)